@@ -0,0 +1,186 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/gpio.h>
+#include <esp_timer.h>
+#include <esp_idf_lib_helpers.h>
+#include <hd44780.h>
+
+/* Times each hd44780 driver operation on the wiper board's LCD wiring, once with the
+driver toggling the GPIOs itself, once through a write_cb that maps the register
+bits onto the same pins and once on an 8 bit bus (the same pins plus D0-D3 on spare
+GPIOs, see below). Results are printed as CSV lines starting with "bench,":
+
+    bench,<transport>,<op>,<samples>,<min_us>,<median_us>,<max_us>,<chars_per_s>
+
+chars_per_s is the character throughput at the median (0 for operations that do not
+write characters). tools/bench_compare.py diffs two captured logs. */
+
+#define BENCH_SAMPLES   (101)           // odd, so the median is a single sample
+#define LCD_RS          GPIO_NUM_39     // same wiring as main/main.c
+#define LCD_E           GPIO_NUM_37
+#define LCD_D4          GPIO_NUM_36
+#define LCD_D5          GPIO_NUM_35
+#define LCD_D6          GPIO_NUM_48
+#define LCD_D7          GPIO_NUM_47
+#define LCD_D0          GPIO_NUM_13     // spare pins on the wiper board, only for the 8 bit run
+#define LCD_D1          GPIO_NUM_14
+#define LCD_D2          GPIO_NUM_21
+#define LCD_D3          GPIO_NUM_38
+
+// register bit of each signal for the write_cb transport
+enum { CB_RS, CB_E, CB_D4, CB_D5, CB_D6, CB_D7, CB_BL, CB_BITS };
+
+static const gpio_num_t cb_pins[CB_BITS - 1] = { LCD_RS, LCD_E, LCD_D4, LCD_D5, LCD_D6, LCD_D7 };
+
+typedef struct {
+    const char *name;
+    int chars;                  // characters written per call
+    esp_err_t (*run)(const hd44780_t *lcd);
+} bench_op_t;
+
+static const uint8_t char_data[8] = { 0x04, 0x0e, 0x0e, 0x0e, 0x1f, 0x00, 0x04, 0x00 };
+static const char line_text[] = "Wipers: HIGH    ";    // a full 16 character line
+
+// write_cb transport: drive each signal whose register bit is in data
+static esp_err_t cb_write(const hd44780_t *lcd, uint8_t data)
+{
+    for (int bit = 0; bit < CB_BITS - 1; bit++){
+        gpio_set_level(cb_pins[bit], (data >> bit) & 1);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t op_putc(const hd44780_t *lcd)
+{
+    return hd44780_putc(lcd, 'W');
+}
+
+static esp_err_t op_puts(const hd44780_t *lcd)
+{
+    return hd44780_puts(lcd, line_text);
+}
+
+static esp_err_t op_gotoxy(const hd44780_t *lcd)
+{
+    return hd44780_gotoxy(lcd, 0, 1);
+}
+
+static esp_err_t op_clear(const hd44780_t *lcd)
+{
+    return hd44780_clear(lcd);
+}
+
+static esp_err_t op_upload_character(const hd44780_t *lcd)
+{
+    return hd44780_upload_character(lcd, 0, char_data);
+}
+
+static const bench_op_t ops[] = {
+    { "putc", 1, op_putc },
+    { "puts", sizeof(line_text) - 1, op_puts },
+    { "gotoxy", 0, op_gotoxy },
+    { "clear", 0, op_clear },
+    { "upload_character", 0, op_upload_character },
+};
+
+static int cmp_us(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_transport(const char *transport, const hd44780_t *lcd)
+{
+    static int64_t samples[BENCH_SAMPLES];
+
+    ESP_ERROR_CHECK(hd44780_init(lcd));
+
+    for (int i = 0; i < (int)(sizeof(ops) / sizeof(ops[0])); i++){
+        for (int n = 0; n < BENCH_SAMPLES; n++){
+            hd44780_gotoxy(lcd, 0, 0);                  // keep putc/puts on the visible line
+            int64_t start = esp_timer_get_time();
+            ESP_ERROR_CHECK(ops[i].run(lcd));
+            samples[n] = esp_timer_get_time() - start;
+            if (n % 20 == 19){
+                vTaskDelay(1);                          // let the idle task feed the watchdog
+            }
+        }
+        qsort(samples, BENCH_SAMPLES, sizeof(samples[0]), cmp_us);
+        int64_t median = samples[BENCH_SAMPLES / 2];
+        printf("bench,%s,%s,%d,%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 "\n",
+               transport, ops[i].name, BENCH_SAMPLES, samples[0], median, samples[BENCH_SAMPLES - 1],
+               median > 0 ? (int64_t)ops[i].chars * 1000000 / median : 0);
+    }
+}
+
+static void bench_task(void *pvParameters)
+{
+    const hd44780_t gpio_lcd =
+    {
+        .write_cb = NULL,
+        .font = HD44780_FONT_5X8,
+        .lines = 2,
+        .pins = {
+            .rs = LCD_RS,
+            .e  = LCD_E,
+            .d4 = LCD_D4,
+            .d5 = LCD_D5,
+            .d6 = LCD_D6,
+            .d7 = LCD_D7,
+            .bl = HD44780_NOT_USED
+        }
+    };
+    const hd44780_t cb_lcd =
+    {
+        .write_cb = cb_write,
+        .font = HD44780_FONT_5X8,
+        .lines = 2,
+        .pins = {
+            .rs = CB_RS,
+            .e  = CB_E,
+            .d4 = CB_D4,
+            .d5 = CB_D5,
+            .d6 = CB_D6,
+            .d7 = CB_D7,
+            .bl = CB_BL
+        }
+    };
+
+    const hd44780_t gpio8_lcd =
+    {
+        .write_cb = NULL,
+        .font = HD44780_FONT_5X8,
+        .lines = 2,
+        .bus = HD44780_BUS_8BIT,
+        .pins = {
+            .rs = LCD_RS,
+            .e  = LCD_E,
+            .d0 = LCD_D0,
+            .d1 = LCD_D1,
+            .d2 = LCD_D2,
+            .d3 = LCD_D3,
+            .d4 = LCD_D4,
+            .d5 = LCD_D5,
+            .d6 = LCD_D6,
+            .d7 = LCD_D7,
+            .bl = HD44780_NOT_USED
+        }
+    };
+
+    printf("bench,transport,op,samples,min_us,median_us,max_us,chars_per_s\n");
+    bench_transport("gpio", &gpio_lcd);     // also configures the pins as outputs for write_cb
+    bench_transport("write_cb", &cb_lcd);
+    bench_transport("gpio8", &gpio8_lcd);   // needs D0-D3 wired, the 4 bit runs ignore them
+    printf("bench,done\n");
+    vTaskDelete(NULL);
+}
+
+void app_main()
+{
+    // above the default tasks so the samples are not stretched by preemption
+    xTaskCreate(bench_task, "bench", 4096, NULL, configMAX_PRIORITIES - 2, NULL);
+}
@@ -40,7 +40,13 @@
 #include <esp_system.h>
 #include <esp_idf_lib_helpers.h>
 #include <ets_sys.h>
+#include <esp_timer.h>
 #include "hd44780.h"
+#if !defined(CONFIG_IDF_TARGET_ESP8266)
+#include <soc/soc.h>
+#include <soc/soc_caps.h>
+#include <soc/gpio_reg.h>
+#endif
 
 #define MS 1000
 
@@ -120,10 +126,96 @@ static esp_err_t write_nibble(const hd44780_t *lcd, uint8_t b, bool rs)
     return ESP_OK;
 }
 
+// only one panel on a shared bus may drive RS and the data lines at a time
+static void bus_take(const hd44780_t *lcd)
+{
+    if (lcd->shared)
+        xSemaphoreTake(lcd->shared->lock, portMAX_DELAY);
+}
+
+static void bus_give(const hd44780_t *lcd)
+{
+    if (lcd->shared)
+        xSemaphoreGive(lcd->shared->lock);
+}
+
+// 8 bit bus: RS and D0-D7 change together, then a single E strobe
+static esp_err_t write_bus8(const hd44780_t *lcd, uint8_t b, bool rs)
+{
+    const uint8_t pins[] = {
+        lcd->pins.d0, lcd->pins.d1, lcd->pins.d2, lcd->pins.d3,
+        lcd->pins.d4, lcd->pins.d5, lcd->pins.d6, lcd->pins.d7,
+        lcd->pins.rs
+    };
+    uint16_t bits = b | (rs ? BV(8) : 0);
+
+#if defined(CONFIG_IDF_TARGET_ESP8266)
+    for (uint8_t i = 0; i < sizeof(pins); i++)
+        CHECK(gpio_set_level(pins[i], (bits >> i) & 1));
+#else
+    uint64_t set = 0;
+    uint64_t clear = 0;
+
+    for (uint8_t i = 0; i < sizeof(pins); i++)
+    {
+        if ((bits >> i) & 1)
+            set |= GPIO_BIT(pins[i]);
+        else
+            clear |= GPIO_BIT(pins[i]);
+    }
+    // one write-1-to-set and one write-1-to-clear store per GPIO bank, other pins are untouched
+    REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)clear);
+    REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t)set);
+#if SOC_GPIO_PIN_COUNT > 32
+    REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t)(clear >> 32));
+    REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t)(set >> 32));
+#endif
+#endif
+    ets_delay_us(1); // Address Setup time >= 60ns.
+    CHECK(gpio_set_level(lcd->pins.e, true));
+    toggle_delay();
+    CHECK(gpio_set_level(lcd->pins.e, false));
+
+    return ESP_OK;
+}
+
+// one byte on the bus, both nibbles under the shared bus lock. The execution delay
+// that follows is left to the caller, so other panels can use the bus meanwhile
 static esp_err_t write_byte(const hd44780_t *lcd, uint8_t b, bool rs)
 {
-    CHECK(write_nibble(lcd, b >> 4, rs));
-    CHECK(write_nibble(lcd, b, rs));
+    esp_err_t res;
+
+    bus_take(lcd);
+    if (lcd->bus == HD44780_BUS_8BIT)
+        res = write_bus8(lcd, b, rs);
+    else
+    {
+        res = write_nibble(lcd, b >> 4, rs);
+        if (res == ESP_OK)
+            res = write_nibble(lcd, b, rs);
+    }
+    bus_give(lcd);
+
+    return res;
+}
+
+// a single strobe of the init sequence, while the interface width is not known yet
+static esp_err_t write_init(const hd44780_t *lcd, uint8_t b)
+{
+    esp_err_t res;
+
+    bus_take(lcd);
+    res = lcd->bus == HD44780_BUS_8BIT ? write_bus8(lcd, b, false) : write_nibble(lcd, b >> 4, false);
+    bus_give(lcd);
+
+    return res;
+}
+
+esp_err_t hd44780_shared_init(hd44780_shared_bus_t *bus)
+{
+    CHECK_ARG(bus);
+
+    bus->lock = xSemaphoreCreateMutexStatic(&bus->lock_buf);
 
     return ESP_OK;
 }
@@ -131,6 +223,8 @@ static esp_err_t write_byte(const hd44780_t *lcd, uint8_t b, bool rs)
 esp_err_t hd44780_init(const hd44780_t *lcd)
 {
     CHECK_ARG(lcd && lcd->lines > 0 && lcd->lines < 5);
+    if (lcd->bus == HD44780_BUS_8BIT && lcd->write_cb)
+        return ESP_ERR_NOT_SUPPORTED;   // a register byte has no room for D0-D3
 
     if (!lcd->write_cb)
     {
@@ -146,21 +240,35 @@ esp_err_t hd44780_init(const hd44780_t *lcd)
             GPIO_BIT(lcd->pins.d7);
         if (lcd->pins.bl != HD44780_NOT_USED)
             io_conf.pin_bit_mask |= GPIO_BIT(lcd->pins.bl);
-        CHECK(gpio_config(&io_conf));
+        if (lcd->bus == HD44780_BUS_8BIT)
+            io_conf.pin_bit_mask |=
+                GPIO_BIT(lcd->pins.d0) |
+                GPIO_BIT(lcd->pins.d1) |
+                GPIO_BIT(lcd->pins.d2) |
+                GPIO_BIT(lcd->pins.d3);
+        bus_take(lcd);          // the shared pins may be mid-write for another panel
+        esp_err_t res = gpio_config(&io_conf);
+        bus_give(lcd);
+        CHECK(res);
     }
 
-    // switch to 4 bit mode
+    // reset by instruction, the controller is in 8 bit mode after it
     for (uint8_t i = 0; i < 3; i ++)
     {
-        CHECK(write_nibble(lcd, (CMD_FUNC_SET | ARG_FS_8_BIT) >> 4, false));
+        CHECK(write_init(lcd, CMD_FUNC_SET | ARG_FS_8_BIT));
         init_delay();
     }
-    CHECK(write_nibble(lcd, CMD_FUNC_SET >> 4, false));
-    short_delay();
+    if (lcd->bus == HD44780_BUS_4BIT)
+    {
+        // switch to 4 bit mode
+        CHECK(write_init(lcd, CMD_FUNC_SET));
+        short_delay();
+    }
 
-    // Specify the number of display lines and character font
+    // Specify the bus width, the number of display lines and character font
     CHECK(write_byte(lcd,
                      CMD_FUNC_SET
+                     | (lcd->bus == HD44780_BUS_8BIT ? ARG_FS_8_BIT : 0)
                      | (lcd->lines > 1 ? ARG_FS_2_LINES : 0)
                      | (lcd->font == HD44780_FONT_5X10 ? ARG_FS_FONT_5X10 : 0),
                      false));
@@ -236,6 +344,101 @@ esp_err_t hd44780_puts(const hd44780_t *lcd, const char *s)
     return ESP_OK;
 }
 
+esp_err_t hd44780_write_batch(const hd44780_write_t *writes, size_t count)
+{
+    struct
+    {
+        const hd44780_t *lcd;
+        size_t next;        // write in progress, count when done
+        int pos;            // next character of it, -1 for its address command
+        int64_t ready_us;   // time the panel has executed its last byte
+    } panels[HD44780_BATCH_PANELS];
+    size_t n = 0;
+    size_t p;
+    size_t i;
+
+    CHECK_ARG(writes || !count);
+
+    // each panel starts on its first write
+    for (i = 0; i < count; i++)
+    {
+        const hd44780_t *lcd = writes[i].lcd;
+        CHECK_ARG(lcd && writes[i].text && writes[i].line < lcd->lines && writes[i].line < sizeof(line_addr));
+        for (p = 0; p < n && panels[p].lcd != lcd; p++)
+            ;
+        if (p == n)
+        {
+            CHECK_ARG(n < HD44780_BATCH_PANELS);
+            panels[n].lcd = lcd;
+            panels[n].next = i;
+            panels[n].pos = -1;
+            panels[n].ready_us = 0;
+            n++;
+        }
+    }
+
+    // round robin over the panels, one byte each as soon as it can take one
+    while (1)
+    {
+        int64_t wait_until = INT64_MAX;
+        bool busy = false;
+
+        for (p = 0; p < n; p++)
+        {
+            const hd44780_write_t *w;
+            int64_t now;
+
+            if (panels[p].next == count)
+                continue;
+            busy = true;
+            now = esp_timer_get_time();
+            if (now < panels[p].ready_us)
+            {
+                if (panels[p].ready_us < wait_until)
+                    wait_until = panels[p].ready_us;
+                continue;
+            }
+
+            w = &writes[panels[p].next];
+            if (panels[p].pos < 0)
+                CHECK(write_byte(w->lcd, CMD_DDRAM_ADDR + line_addr[w->line] + w->col, false));
+            else
+                CHECK(write_byte(w->lcd, w->text[panels[p].pos], true));
+            panels[p].pos++;
+            panels[p].ready_us = esp_timer_get_time() + DELAY_CMD_SHORT;
+            wait_until = 0;
+
+            // on to this panel's next write
+            if (w->text[panels[p].pos] == '\0')
+            {
+                for (i = panels[p].next + 1; i < count && writes[i].lcd != panels[p].lcd; i++)
+                    ;
+                panels[p].next = i;
+                panels[p].pos = -1;
+            }
+        }
+        if (!busy)
+            break;
+        if (wait_until != 0)
+        {
+            // every panel with bytes left is still executing, wait for the first to finish
+            int64_t left = wait_until - esp_timer_get_time();
+            if (left > 0)
+                ets_delay_us(left);
+        }
+    }
+
+    // every panel has executed its last byte before anything else is sent
+    for (p = 0; p < n; p++)
+    {
+        int64_t left = panels[p].ready_us - esp_timer_get_time();
+        if (left > 0)
+            ets_delay_us(left);
+    }
+
+    return ESP_OK;
+}
+
 esp_err_t hd44780_switch_backlight(hd44780_t *lcd, bool on)
 {
     CHECK_ARG(lcd);
@@ -43,14 +43,18 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <driver/gpio.h>
 #include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define HD44780_NOT_USED 0xff
+#define HD44780_BATCH_PANELS 4  //!< Most panels one hd44780_write_batch() call can address
 
 /**
  * LCD font type. Please refer to the datasheet
@@ -62,6 +66,25 @@ typedef enum
     HD44780_FONT_5X10
 } hd44780_font_t;
 
+/**
+ * Data bus width of a direct GPIO connection
+ */
+typedef enum
+{
+    HD44780_BUS_4BIT = 0, //!< D4-D7 only, two E strobes per byte
+    HD44780_BUS_8BIT      //!< D0-D7, one E strobe per byte. GPIO connection only (no write_cb)
+} hd44780_bus_t;
+
+/**
+ * Bus shared by several panels: they have common RS and data pins and
+ * their own E pin. Call hd44780_shared_init() once before any panel uses it.
+ */
+typedef struct
+{
+    SemaphoreHandle_t lock;      //!< Held for every byte on the bus
+    StaticSemaphore_t lock_buf;
+} hd44780_shared_bus_t;
+
 typedef struct hd44780 hd44780_t;
 
 typedef esp_err_t (*hd44780_write_cb_t)(const hd44780_t *lcd, uint8_t data);
@@ -81,19 +104,44 @@ struct hd44780
         uint8_t d6;        //!< GPIO/register bit used for D5 pin
         uint8_t d7;        //!< GPIO/register bit used for D5 pin
         uint8_t bl;        //!< GPIO/register bit used for backlight. Set it `HD44780_NOT_USED` if no backlight used
+        uint8_t d0;        //!< GPIO used for D0 pin, 8 bit bus only
+        uint8_t d1;        //!< GPIO used for D1 pin, 8 bit bus only
+        uint8_t d2;        //!< GPIO used for D2 pin, 8 bit bus only
+        uint8_t d3;        //!< GPIO used for D3 pin, 8 bit bus only
     } pins;
     hd44780_font_t font;   //!< LCD Font type
     uint8_t lines;         //!< Number of lines for LCD. Many 16x1 LCD has two lines (like 8x2)
     bool backlight;        //!< Current backlight state
+    hd44780_bus_t bus;     //!< Data bus width, 4 bit by default
+    hd44780_shared_bus_t *shared; //!< Bus this panel shares with others, NULL if it has its own pins
 };
 
+/**
+ * Text to write at a position, for hd44780_write_batch()
+ */
+typedef struct
+{
+    const hd44780_t *lcd;  //!< Panel
+    uint8_t col;           //!< Column of the first character
+    uint8_t line;          //!< Line
+    const char *text;      //!< NULL-terminated characters
+} hd44780_write_t;
+
+/**
+ * @brief Init a bus shared by several panels
+ *
+ * @param bus Shared bus, pointed to by the `shared` field of every panel on it
+ * @return `ESP_OK` on success
+ */
+esp_err_t hd44780_shared_init(hd44780_shared_bus_t *bus);
+
 /**
  * @brief Init LCD
  *
  * Set cursor position to (0, 0)
  *
  * @param lcd LCD descriptor
- * @return `ESP_OK` on success
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_SUPPORTED` for an 8 bit bus with write_cb
  */
 esp_err_t hd44780_init(const hd44780_t *lcd);
 
@@ -148,6 +196,21 @@ esp_err_t hd44780_putc(const hd44780_t *lcd, char c);
  */
 esp_err_t hd44780_puts(const hd44780_t *lcd, const char *s);
 
+/**
+ * @brief Write several texts, possibly to different panels on a shared bus
+ *
+ * Writes to one panel are done in order. Bytes for different panels are
+ * interleaved, so the bus is busy with one panel while the others execute
+ * their last command, instead of waiting out each panel's delay in turn.
+ * Returns when every panel has executed its last byte.
+ *
+ * @param writes Texts to write
+ * @param count Number of texts
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_ARG` for more than
+ *         HD44780_BATCH_PANELS different panels
+ */
+esp_err_t hd44780_write_batch(const hd44780_write_t *writes, size_t count);
+
 /**
  * @brief Switch backlight
  *
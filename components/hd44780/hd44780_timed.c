@@ -0,0 +1,219 @@
+/**
+ * @file hd44780_timed.c
+ *
+ * Timer driven transport for HD44780 panels on direct GPIO connections
+ */
+#include <string.h>
+#include <esp_attr.h>
+#include <ets_sys.h>
+#include <soc/soc.h>
+#include <soc/soc_caps.h>
+#include <soc/gpio_reg.h>
+#include "hd44780_timed.h"
+
+#define TIMED_RESOLUTION_HZ 1000000
+#define TIMED_PERIOD_US     60      // >39us command execution time, the driver's short delay
+#define TIMED_MARGIN_MS     20      // extra wait for the last interrupt of a run
+
+#define CMD_DDRAM_ADDR      0x80
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+
+static const uint8_t line_addr[] = { 0x00, 0x40, 0x14, 0x54 };    // same as hd44780.c
+
+static void add_pin(uint32_t *banks, uint8_t pin)
+{
+    banks[pin / 32] |= 1UL << (pin % 32);
+}
+
+// RS and data levels of one strobe, bits are D0-D7 on an 8 bit bus and D4-D7 (in the low nibble) on a 4 bit bus
+static void bus_word(const hd44780_timed_t *dev, hd44780_timed_word_t *word, uint8_t bits, bool rs)
+{
+    const hd44780_t *lcd = dev->lcd;
+    const uint8_t pins[] = {
+        lcd->pins.d0, lcd->pins.d1, lcd->pins.d2, lcd->pins.d3,
+        lcd->pins.d4, lcd->pins.d5, lcd->pins.d6, lcd->pins.d7
+    };
+    uint8_t first = lcd->bus == HD44780_BUS_8BIT ? 0 : 4;
+
+    memset(word, 0, sizeof(*word));
+    for (uint8_t i = first; i < 8; i++)
+        if ((bits >> (i - first)) & 1)
+            add_pin(word->set, pins[i]);
+    if (rs)
+        add_pin(word->set, lcd->pins.rs);
+}
+
+// one byte per alarm, then one more alarm for its execution time before the task is woken
+static bool IRAM_ATTR timed_alarm(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *ctx)
+{
+    hd44780_timed_t *dev = ctx;
+    BaseType_t woken = pdFALSE;
+    size_t i = dev->sent;
+
+    if (i == dev->count)
+    {
+        gptimer_stop(timer);
+        xSemaphoreGiveFromISR(dev->done, &woken);
+        return woken == pdTRUE;
+    }
+
+    const uint32_t *e = dev->e[dev->word_panel[i]];
+    for (uint8_t n = 0; n < dev->words_per_byte; n++)
+    {
+        const hd44780_timed_word_t *w = &dev->words[i * dev->words_per_byte + n];
+
+        REG_WRITE(GPIO_OUT_W1TC_REG, dev->bus[0] & ~w->set[0]);
+        REG_WRITE(GPIO_OUT_W1TS_REG, w->set[0]);
+#if SOC_GPIO_PIN_COUNT > 32
+        REG_WRITE(GPIO_OUT1_W1TC_REG, dev->bus[1] & ~w->set[1]);
+        REG_WRITE(GPIO_OUT1_W1TS_REG, w->set[1]);
+#endif
+        ets_delay_us(1); // Address Setup time >= 60ns.
+        REG_WRITE(GPIO_OUT_W1TS_REG, e[0]);
+#if SOC_GPIO_PIN_COUNT > 32
+        REG_WRITE(GPIO_OUT1_W1TS_REG, e[1]);
+#endif
+        ets_delay_us(1); // E pulse width >= 450ns, Data set-up time >= 195ns
+        REG_WRITE(GPIO_OUT_W1TC_REG, e[0]);
+#if SOC_GPIO_PIN_COUNT > 32
+        REG_WRITE(GPIO_OUT1_W1TC_REG, e[1]);
+#endif
+    }
+    dev->sent = i + 1;
+
+    return false;
+}
+
+esp_err_t hd44780_timed_init(hd44780_timed_t *dev)
+{
+    CHECK_ARG(dev && dev->lcd);
+    if (dev->lcd->write_cb)
+        return ESP_ERR_NOT_SUPPORTED;
+
+    const hd44780_t *lcd = dev->lcd;
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = TIMED_RESOLUTION_HZ,
+    };
+    gptimer_alarm_config_t alarm_config = {
+        .alarm_count = TIMED_PERIOD_US,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true,
+    };
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = timed_alarm,
+    };
+
+    memset(dev->bus, 0, sizeof(dev->bus));
+    add_pin(dev->bus, lcd->pins.rs);
+    add_pin(dev->bus, lcd->pins.d4);
+    add_pin(dev->bus, lcd->pins.d5);
+    add_pin(dev->bus, lcd->pins.d6);
+    add_pin(dev->bus, lcd->pins.d7);
+    if (lcd->bus == HD44780_BUS_8BIT)
+    {
+        add_pin(dev->bus, lcd->pins.d0);
+        add_pin(dev->bus, lcd->pins.d1);
+        add_pin(dev->bus, lcd->pins.d2);
+        add_pin(dev->bus, lcd->pins.d3);
+    }
+    dev->words_per_byte = lcd->bus == HD44780_BUS_8BIT ? 1 : 2;
+    dev->done = xSemaphoreCreateBinaryStatic(&dev->done_buf);
+
+    CHECK(gptimer_new_timer(&timer_config, &dev->timer));
+    CHECK(gptimer_set_alarm_action(dev->timer, &alarm_config));
+    CHECK(gptimer_register_event_callbacks(dev->timer, &callbacks, dev));
+    CHECK(gptimer_enable(dev->timer));
+
+    return ESP_OK;
+}
+
+// put the bytes collected so far on the bus and sleep until the last one has executed
+static esp_err_t timed_run(hd44780_timed_t *dev)
+{
+    esp_err_t res = ESP_OK;
+
+    if (!dev->count)
+        return ESP_OK;
+
+    dev->sent = 0;
+    xSemaphoreTake(dev->done, 0);                                   // drop a stale completion
+    CHECK(gptimer_set_raw_count(dev->timer, TIMED_PERIOD_US - 1));  // first byte right away
+    CHECK(gptimer_start(dev->timer));
+    if (xSemaphoreTake(dev->done, pdMS_TO_TICKS((dev->count + 1) * TIMED_PERIOD_US / 1000 + TIMED_MARGIN_MS) + 1) != pdTRUE)
+    {
+        gptimer_stop(dev->timer);
+        res = ESP_ERR_TIMEOUT;
+    }
+    dev->count = 0;
+    dev->panel_count = 0;
+
+    return res;
+}
+
+// queue one byte for a panel, running the timer first if the buffer or the panel table is full
+static esp_err_t timed_byte(hd44780_timed_t *dev, const hd44780_t *lcd, uint8_t b, bool rs)
+{
+    size_t p;
+
+    for (p = 0; p < dev->panel_count && dev->panels[p] != lcd; p++)
+        ;
+    if (dev->count == HD44780_TIMED_MAX_BYTES || p == HD44780_BATCH_PANELS)
+    {
+        CHECK(timed_run(dev));
+        p = 0;
+    }
+    if (p == dev->panel_count)
+    {
+        dev->panels[p] = lcd;
+        memset(dev->e[p], 0, sizeof(dev->e[p]));
+        add_pin(dev->e[p], lcd->pins.e);
+        dev->panel_count++;
+    }
+
+    hd44780_timed_word_t *w = &dev->words[dev->count * dev->words_per_byte];
+    if (dev->words_per_byte == 2)
+    {
+        bus_word(dev, &w[0], b >> 4, rs);
+        bus_word(dev, &w[1], b & 0x0f, rs);
+    }
+    else
+        bus_word(dev, &w[0], b, rs);
+    dev->word_panel[dev->count++] = p;
+
+    return ESP_OK;
+}
+
+esp_err_t hd44780_timed_write(hd44780_timed_t *dev, const hd44780_write_t *writes, size_t count)
+{
+    esp_err_t res = ESP_OK;
+    size_t i;
+
+    CHECK_ARG(dev && dev->timer && (writes || !count));
+    for (i = 0; i < count; i++)
+    {
+        const hd44780_t *lcd = writes[i].lcd;
+        CHECK_ARG(lcd && writes[i].text && !lcd->write_cb && lcd->bus == dev->lcd->bus
+                  && writes[i].line < lcd->lines && writes[i].line < sizeof(line_addr));
+    }
+
+    if (dev->lcd->shared)
+        xSemaphoreTake(dev->lcd->shared->lock, portMAX_DELAY);
+    dev->count = 0;
+    dev->panel_count = 0;
+    for (i = 0; i < count && res == ESP_OK; i++)
+    {
+        res = timed_byte(dev, writes[i].lcd, CMD_DDRAM_ADDR + line_addr[writes[i].line] + writes[i].col, false);
+        for (const char *c = writes[i].text; *c && res == ESP_OK; c++)
+            res = timed_byte(dev, writes[i].lcd, *c, true);
+    }
+    if (res == ESP_OK)
+        res = timed_run(dev);
+    if (dev->lcd->shared)
+        xSemaphoreGive(dev->lcd->shared->lock);
+
+    return res;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file hd44780_timed.h
+ * @defgroup hd44780_timed hd44780_timed
+ * @{
+ *
+ * Timer driven transport for HD44780 panels on direct GPIO connections
+ *
+ * The RS, data and E levels of a whole list of texts are computed up front.
+ * A hardware timer interrupt then puts one byte on the bus per command
+ * execution period through the GPIO set/clear registers, while the calling
+ * task sleeps. A 16 character line costs the CPU 17 short interrupts instead
+ * of a millisecond of busy waiting.
+ *
+ * Not for the I2C/write_cb connection. Commands with a long execution time
+ * (clear, home) and the init sequence still go through the blocking driver.
+ */
+#ifndef __HD44780_TIMED_H__
+#define __HD44780_TIMED_H__
+
+#include <driver/gptimer.h>
+#include "hd44780.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HD44780_TIMED_MAX_BYTES 96      //!< Bytes per timer run, longer lists are sent in several runs
+#define HD44780_TIMED_BANKS     2       //!< GPIO banks of 32 pins covered by the output registers
+
+/**
+ * Levels of RS and the data lines for one E strobe
+ */
+typedef struct
+{
+    uint32_t set[HD44780_TIMED_BANKS]; //!< Lines driven high, the other bus lines are driven low
+} hd44780_timed_word_t;
+
+/**
+ * Timer driven transport. Fill `lcd` and call hd44780_timed_init()
+ */
+typedef struct
+{
+    const hd44780_t *lcd;              //!< Panel whose RS and data pins (and bus width) the transport drives
+    gptimer_handle_t timer;
+    SemaphoreHandle_t done;
+    StaticSemaphore_t done_buf;
+    uint32_t bus[HD44780_TIMED_BANKS]; //!< RS and data line masks
+    uint32_t e[HD44780_BATCH_PANELS][HD44780_TIMED_BANKS]; //!< E line of each panel in the current run
+    const hd44780_t *panels[HD44780_BATCH_PANELS];
+    size_t panel_count;
+    hd44780_timed_word_t words[HD44780_TIMED_MAX_BYTES * 2];
+    uint8_t word_panel[HD44780_TIMED_MAX_BYTES];  //!< Panel of each byte
+    uint8_t words_per_byte;            //!< 2 nibbles on a 4 bit bus, 1 on an 8 bit bus
+    volatile size_t count;             //!< Bytes in the current run
+    volatile size_t sent;              //!< Bytes of it already on the bus
+} hd44780_timed_t;
+
+/**
+ * @brief Create the timer of a timed transport
+ *
+ * The panels must be initialised with hd44780_init() as usual.
+ *
+ * @param dev Transport with `lcd` filled in
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_SUPPORTED` for a write_cb panel
+ */
+esp_err_t hd44780_timed_init(hd44780_timed_t *dev);
+
+/**
+ * @brief Write several texts through the timer and sleep until they are done
+ *
+ * Same arguments as hd44780_write_batch(). The panels must share the RS and
+ * data pins of `dev->lcd` (the same panel, or panels on one shared bus).
+ * The shared bus lock is held for the whole transfer.
+ *
+ * @param dev Transport
+ * @param writes Texts to write
+ * @param count Number of texts
+ * @return `ESP_OK` on success, `ESP_ERR_TIMEOUT` if the timer stopped firing
+ */
+esp_err_t hd44780_timed_write(hd44780_timed_t *dev, const hd44780_write_t *writes, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __HD44780_TIMED_H__ */
@@ -0,0 +1,332 @@
+#include "analog_in.h"
+#include "freertos/FreeRTOS.h"
+#include <freertos/task.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "esp_attr.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "soc/soc_caps.h"
+
+#define ANALOG_RATE_STEP_HZ (500)   // every input rate is a multiple of this, one pattern slot per step
+#define ANALOG_KNOB_HZ      (500)   // wiper and intermittence knobs
+#define ANALOG_FEEDBACK_HZ  (1000)  // servo position potentiometer
+#define ANALOG_CURRENT_HZ   (5000)  // motor current sense, fast enough for the instantaneous trip
+
+#if CONFIG_WIPER_SERVO_FEEDBACK
+#define ANALOG_FEEDBACK_TOTAL_HZ    ANALOG_FEEDBACK_HZ
+#else
+#define ANALOG_FEEDBACK_TOTAL_HZ    (0)
+#endif
+#if CONFIG_WIPER_CURRENT_PROTECTION
+#define ANALOG_CURRENT_TOTAL_HZ     ANALOG_CURRENT_HZ
+#define ANALOG_FRAME_MS     (2)     // short frames so the current check runs every 2ms
+#else
+#define ANALOG_CURRENT_TOTAL_HZ     (0)
+#define ANALOG_FRAME_MS     (10)    // one DMA frame per control loop period
+#endif
+#define ANALOG_SAMPLE_HZ    (2 * ANALOG_KNOB_HZ + ANALOG_FEEDBACK_TOTAL_HZ + ANALOG_CURRENT_TOTAL_HZ)
+#define ANALOG_PATTERN_LEN  (ANALOG_SAMPLE_HZ / ANALOG_RATE_STEP_HZ)
+#define ANALOG_FRAME_RESULTS (ANALOG_SAMPLE_HZ * ANALOG_FRAME_MS / 1000)
+#define ANALOG_FRAME_BYTES  (ANALOG_FRAME_RESULTS * SOC_ADC_DIGI_RESULT_BYTES)
+#define ANALOG_CAL_RAW_LO   (400)   // raw codes used to fit the ISR-safe linear calibration
+#define ANALOG_CAL_RAW_HI   (3600)
+#define ANALOG_RAW_MAX      ((1 << SOC_ADC_DIGI_MAX_BITWIDTH) - 1)
+#define ANALOG_EMA_FRAC     (8)     // fraction bits kept by the exponential smoothing
+#define ANALOG_TASK_STACK   (3072)
+
+// the inputs: adding a sensor is one row here and one entry in analog_in_t
+static const analog_input_cfg_t analog_inputs[ANALOG_COUNT] = {
+    [ANALOG_WIPER] = {
+        .channel = WIPER_CONTROL, .atten = ADC_ATTEN, .cali = ANALOG_CALI_CURVE,
+        .rate_hz = ANALOG_KNOB_HZ, .window_ms = 10, .ema_shift = 0, .threshold_mv = 20,
+    },
+    [ANALOG_INT_WIPER] = {
+        .channel = INT_WIPER_CONTROL, .atten = ADC_ATTEN, .cali = ANALOG_CALI_CURVE,
+        .rate_hz = ANALOG_KNOB_HZ, .window_ms = 10, .ema_shift = 0, .threshold_mv = 20,
+    },
+#if CONFIG_WIPER_SERVO_FEEDBACK
+    [ANALOG_SERVO_FEEDBACK] = {
+        .channel = CONFIG_WIPER_FEEDBACK_ADC_CHANNEL, .atten = ADC_ATTEN, .cali = ANALOG_CALI_CURVE,
+        .rate_hz = ANALOG_FEEDBACK_HZ, .window_ms = 10, .ema_shift = 0, .threshold_mv = 10,
+    },
+#endif
+#if CONFIG_WIPER_CURRENT_PROTECTION
+    [ANALOG_MOTOR_CURRENT] = {
+        .channel = CONFIG_WIPER_CURRENT_ADC_CHANNEL, .atten = ADC_ATTEN, .cali = ANALOG_CALI_CURVE,
+        .rate_hz = ANALOG_CURRENT_HZ, .window_ms = 10, .ema_shift = 2, .threshold_mv = 50,
+    },
+#endif
+};
+
+// nominal full scale of each attenuation (mV), used by ANALOG_CALI_NOMINAL
+static const int nominal_mv[] = {
+    [ADC_ATTEN_DB_0]   = 950,
+    [ADC_ATTEN_DB_2_5] = 1250,
+    [ADC_ATTEN_DB_6]   = 1750,
+    [ADC_ATTEN_DB_12]  = 3100,
+};
+
+typedef struct {
+    analog_in_t input;
+    analog_change_handler_t handler;
+    void *ctx;
+} analog_subscriber_t;
+
+static adc_continuous_handle_t adc1_handle;     // continuous unit handle
+static adc_cali_handle_t cali_handles[ADC_ATTEN_DB_12 + 1];    // curve fitting per attenuation in use
+static TaskHandle_t analog_task_handle;         // task that drains DMA frames
+#if CONFIG_WIPER_STATIC_ALLOC
+static StackType_t analog_stack[ANALOG_TASK_STACK];
+static StaticTask_t analog_tcb;
+#endif
+static int8_t channel_input[16];                // analog_in_t of each ADC1 channel, -1 if unused
+static volatile int analog_mv[ANALOG_COUNT];    // latest reading of each input (mV)
+static analog_fast_handler_t fast_handler[ANALOG_COUNT];   // ISR handlers for raw samples
+static int cal_mv_lo[ANALOG_COUNT];             // mV at ANALOG_CAL_RAW_LO
+static int cal_mv_hi[ANALOG_COUNT];             // mV at ANALOG_CAL_RAW_HI
+static analog_subscriber_t subscribers[ANALOG_MAX_SUBSCRIBERS];
+static volatile int subscriber_count;
+
+// DMA frame finished: pass raw samples to any fast handlers, then hand the frame to the analog task
+static bool IRAM_ATTR analog_conv_done(adc_continuous_handle_t handle,
+                                       const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    static int raw[ANALOG_FRAME_RESULTS];
+    BaseType_t woken = pdFALSE;
+
+    for (int input = 0; input < ANALOG_COUNT; input++){
+        if (fast_handler[input] == NULL){
+            continue;
+        }
+        int count = 0;
+        for (uint32_t i = 0; i < edata->size; i += SOC_ADC_DIGI_RESULT_BYTES){
+            const adc_digi_output_data_t *result = (const adc_digi_output_data_t *)&edata->conv_frame_buffer[i];
+            if (result->type2.channel == analog_inputs[input].channel){
+                raw[count++] = result->type2.data;
+            }
+        }
+        fast_handler[input](raw, count, 1000000 / analog_inputs[input].rate_hz);
+    }
+
+    vTaskNotifyGiveFromISR(analog_task_handle, &woken);
+    return woken == pdTRUE;
+}
+
+// calibrated mV of an averaged raw code
+static int analog_to_mv(int input, int raw)
+{
+    const analog_input_cfg_t *cfg = &analog_inputs[input];
+    int mv = 0;
+
+    if (cfg->cali == ANALOG_CALI_CURVE && cali_handles[cfg->atten] != NULL &&
+        adc_cali_raw_to_voltage(cali_handles[cfg->atten], raw, &mv) == ESP_OK){
+        return mv;
+    }
+    return raw * nominal_mv[cfg->atten] / ANALOG_RAW_MAX;
+}
+
+// Task to filter the samples of every input and tell subscribers about changes
+static void analog_task(void *pvParameter)
+{
+    static uint8_t frame[ANALOG_FRAME_BYTES];
+    uint32_t length;
+    int sum[ANALOG_COUNT] = {0};
+    int count[ANALOG_COUNT] = {0};
+    int frames[ANALOG_COUNT] = {0};
+    int ema[ANALOG_COUNT] = {0};            // smoothed mV << ANALOG_EMA_FRAC
+    int reported[ANALOG_COUNT];             // last reading sent to the subscribers
+    bool first[ANALOG_COUNT];
+
+    for (int input = 0; input < ANALOG_COUNT; input++){
+        reported[input] = INT_MIN;
+        first[input] = true;
+    }
+
+    while (1){
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (adc_continuous_read(adc1_handle, frame, sizeof(frame), &length, 0) == ESP_OK){
+            for (uint32_t i = 0; i < length; i += SOC_ADC_DIGI_RESULT_BYTES){
+                adc_digi_output_data_t *result = (adc_digi_output_data_t *)&frame[i];
+                int input = channel_input[result->type2.channel];
+                if (input >= 0){
+                    sum[input] += result->type2.data;
+                    count[input]++;
+                }
+            }
+
+            for (int input = 0; input < ANALOG_COUNT; input++){
+                const analog_input_cfg_t *cfg = &analog_inputs[input];
+
+                // one reading per window, however short the frames are
+                if (++frames[input] < cfg->window_ms / ANALOG_FRAME_MS || count[input] == 0){
+                    continue;
+                }
+                int mv = analog_to_mv(input, sum[input] / count[input]);
+                sum[input] = 0;
+                count[input] = 0;
+                frames[input] = 0;
+
+                if (cfg->ema_shift > 0){
+                    if (first[input]){
+                        ema[input] = mv << ANALOG_EMA_FRAC;
+                    }
+                    ema[input] += ((mv << ANALOG_EMA_FRAC) - ema[input]) >> cfg->ema_shift;
+                    mv = ema[input] >> ANALOG_EMA_FRAC;
+                }
+                first[input] = false;
+                analog_mv[input] = mv;
+
+                // subscribers only hear about moves past the threshold
+                if (reported[input] != INT_MIN && abs(mv - reported[input]) <= cfg->threshold_mv){
+                    continue;
+                }
+                reported[input] = mv;
+                for (int s = 0; s < subscriber_count; s++){
+                    if ((int)subscribers[s].input == input){
+                        subscribers[s].handler(input, mv, subscribers[s].ctx);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// spread each input's slots evenly over the conversion pattern (smooth weighted round robin)
+static void analog_build_pattern(adc_digi_pattern_config_t *pattern)
+{
+    int credit[ANALOG_COUNT] = {0};
+
+    for (int slot = 0; slot < ANALOG_PATTERN_LEN; slot++){
+        int best = 0;
+        for (int input = 0; input < ANALOG_COUNT; input++){
+            credit[input] += analog_inputs[input].rate_hz;
+            if (credit[input] > credit[best]){
+                best = input;
+            }
+        }
+        credit[best] -= ANALOG_SAMPLE_HZ;
+        pattern[slot] = (adc_digi_pattern_config_t){
+            .atten = analog_inputs[best].atten,
+            .channel = analog_inputs[best].channel,
+            .unit = ADC_UNIT_1,
+            .bit_width = BITWIDTH,
+        };
+    }
+}
+
+// calibration handles and the ISR-safe linear fit of every input
+static esp_err_t analog_cali_init(void)
+{
+    for (int input = 0; input < ANALOG_COUNT; input++){
+        const analog_input_cfg_t *cfg = &analog_inputs[input];
+
+        if (cfg->cali == ANALOG_CALI_CURVE && cali_handles[cfg->atten] == NULL){
+            adc_cali_curve_fitting_config_t cali_config = {
+                .unit_id = ADC_UNIT_1,
+                .chan = cfg->channel,
+                .atten = cfg->atten,
+                .bitwidth = BITWIDTH
+            };                                          // Calibration config
+            esp_err_t err = adc_cali_create_scheme_curve_fitting(&cali_config, &cali_handles[cfg->atten]);
+            if (err != ESP_OK){
+                return err;
+            }
+        }
+        cal_mv_lo[input] = analog_to_mv(input, ANALOG_CAL_RAW_LO);
+        cal_mv_hi[input] = analog_to_mv(input, ANALOG_CAL_RAW_HI);
+    }
+    return ESP_OK;
+}
+
+esp_err_t analog_in_init(void)
+{
+    // check the table: rates fill whole pattern slots and add up, windows are whole frames
+    int total_hz = 0;
+    for (int channel = 0; channel < (int)sizeof(channel_input); channel++){
+        channel_input[channel] = -1;
+    }
+    for (int input = 0; input < ANALOG_COUNT; input++){
+        const analog_input_cfg_t *cfg = &analog_inputs[input];
+        if (cfg->rate_hz % ANALOG_RATE_STEP_HZ != 0 || cfg->window_ms % ANALOG_FRAME_MS != 0 ||
+            channel_input[cfg->channel] >= 0){
+            return ESP_ERR_INVALID_ARG;
+        }
+        channel_input[cfg->channel] = input;
+        total_hz += cfg->rate_hz;
+    }
+    if (total_hz != ANALOG_SAMPLE_HZ || ANALOG_PATTERN_LEN > SOC_ADC_PATT_LEN_MAX){
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = 4 * ANALOG_FRAME_BYTES,
+        .conv_frame_size = ANALOG_FRAME_BYTES,
+    };                                                  // DMA pool and frame size
+    esp_err_t err = adc_continuous_new_handle(&handle_config, &adc1_handle);
+    if (err != ESP_OK){
+        return err;
+    }
+
+    adc_digi_pattern_config_t pattern[ANALOG_PATTERN_LEN];
+    analog_build_pattern(pattern);
+
+    adc_continuous_config_t config = {
+        .pattern_num = ANALOG_PATTERN_LEN,
+        .adc_pattern = pattern,
+        .sample_freq_hz = ANALOG_SAMPLE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };                                                  // Conversion pattern config
+    err = adc_continuous_config(adc1_handle, &config);
+    if (err != ESP_OK){
+        return err;
+    }
+
+    err = analog_cali_init();
+    if (err != ESP_OK){
+        return err;
+    }
+
+#if CONFIG_WIPER_STATIC_ALLOC
+    analog_task_handle = xTaskCreateStatic(analog_task, "Analog_Task", ANALOG_TASK_STACK, NULL, 6, analog_stack, &analog_tcb);
+#else
+    xTaskCreate(analog_task, "Analog_Task", ANALOG_TASK_STACK, NULL, 6, &analog_task_handle);
+#endif
+
+    adc_continuous_evt_cbs_t callbacks = {
+        .on_conv_done = analog_conv_done,
+    };
+    err = adc_continuous_register_event_callbacks(adc1_handle, &callbacks, NULL);
+    if (err != ESP_OK){
+        return err;
+    }
+
+    return adc_continuous_start(adc1_handle);
+}
+
+int analog_in_get_mv(analog_in_t input)
+{
+    return analog_mv[input];
+}
+
+esp_err_t analog_in_subscribe(analog_in_t input, analog_change_handler_t handler, void *ctx)
+{
+    if (subscriber_count >= ANALOG_MAX_SUBSCRIBERS){
+        return ESP_ERR_NO_MEM;
+    }
+    subscribers[subscriber_count] = (analog_subscriber_t){ .input = input, .handler = handler, .ctx = ctx };
+    subscriber_count++;         // published last, the analog task only reads complete entries
+    return ESP_OK;
+}
+
+void analog_in_set_fast_handler(analog_in_t input, analog_fast_handler_t handler)
+{
+    fast_handler[input] = handler;
+}
+
+int IRAM_ATTR analog_in_raw_to_mv(analog_in_t input, int raw)
+{
+    return cal_mv_lo[input] + (raw - ANALOG_CAL_RAW_LO) * (cal_mv_hi[input] - cal_mv_lo[input])
+                              / (ANALOG_CAL_RAW_HI - ANALOG_CAL_RAW_LO);
+}
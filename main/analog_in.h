@@ -0,0 +1,67 @@
+#ifndef ANALOG_IN_H
+#define ANALOG_IN_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_adc/adc_continuous.h"
+#include "sdkconfig.h"
+
+#define WIPER_CONTROL       ADC_CHANNEL_8   // wiper control (potentiometer) ADC1 channel 8
+#define INT_WIPER_CONTROL   ADC_CHANNEL_9   // wiper intermittence control (potentiometer) ADC1 channel 9
+#define ADC_ATTEN           ADC_ATTEN_DB_12 // attenuation of the knobs and sensors (0 to ~3.1V)
+#define BITWIDTH            ADC_BITWIDTH_12 // set ADC bitwidth
+#define ANALOG_MAX_SUBSCRIBERS  (4)         // change subscribers across all inputs
+
+// analog inputs sampled by the continuous ADC, one row each in the table in analog_in.c
+typedef enum {
+    ANALOG_WIPER = 0,           // wiper control potentiometer
+    ANALOG_INT_WIPER,           // wiper intermittence potentiometer
+#if CONFIG_WIPER_SERVO_FEEDBACK
+    ANALOG_SERVO_FEEDBACK,      // servo position potentiometer
+#endif
+#if CONFIG_WIPER_CURRENT_PROTECTION
+    ANALOG_MOTOR_CURRENT,       // wiper motor current sense
+#endif
+    ANALOG_COUNT
+} analog_in_t;
+
+// how raw codes become mV
+typedef enum {
+    ANALOG_CALI_CURVE = 0,      // eFuse curve fitting for the input's attenuation
+    ANALOG_CALI_NOMINAL,        // nominal full scale of the attenuation, for ratiometric inputs
+} analog_cali_t;
+
+// one analog input
+typedef struct {
+    adc_channel_t channel;      // ADC1 channel
+    adc_atten_t atten;
+    analog_cali_t cali;
+    int rate_hz;                // conversions per second, a multiple of ANALOG_RATE_STEP_HZ
+    int window_ms;              // samples averaged per reading, a multiple of the DMA frame period
+    int ema_shift;              // 0 = window mean, n = exponential smoothing of the means with weight 1/2^n
+    int threshold_mv;           // subscribers hear about changes larger than this
+} analog_input_cfg_t;
+
+// ISR-context handler for every raw sample of one input in a DMA frame
+typedef void (*analog_fast_handler_t)(const int *raw, int count, int sample_us);
+
+// analog task handler for a reading that moved more than the input's threshold
+typedef void (*analog_change_handler_t)(analog_in_t input, int mv, void *ctx);
+
+// start DMA sampling of every analog input on ADC1
+esp_err_t analog_in_init(void);
+
+// latest filtered reading of an input in mV
+int analog_in_get_mv(analog_in_t input);
+
+// call handler from the analog task whenever the input moves more than its threshold
+// (and once with the first reading), ESP_ERR_NO_MEM if every subscriber slot is taken
+esp_err_t analog_in_subscribe(analog_in_t input, analog_change_handler_t handler, void *ctx);
+
+// route the raw samples of one input straight from the DMA interrupt to handler
+void analog_in_set_fast_handler(analog_in_t input, analog_fast_handler_t handler);
+
+// linear raw to mV conversion for one input that is safe to use in ISR context
+int analog_in_raw_to_mv(analog_in_t input, int raw);
+
+#endif
@@ -0,0 +1,34 @@
+#include "boot_time.h"
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_timer.h"
+
+static const char *phase_names[BOOT_PHASE_COUNT] = {
+    [BOOT_APP_MAIN] = "app_main",
+    [BOOT_INPUTS]   = "inputs",
+    [BOOT_SERVO]    = "servo parked",
+    [BOOT_TASKS]    = "tasks",
+    [BOOT_READY]    = "ready",
+    [BOOT_LCD]      = "LCD",
+};
+static int64_t phase_us[BOOT_PHASE_COUNT];     // 0 until the phase is marked
+static int marked;                              // phases marked so far
+
+// esp_timer starts counting in the startup code, so the times leave out the ROM and second stage bootloaders
+void boot_mark(boot_phase_t phase)
+{
+    int id;
+
+    if (phase_us[phase] != 0){
+        return;                 // a restarted task marks its phase again
+    }
+    phase_us[phase] = esp_timer_get_time();
+    if (__atomic_add_fetch(&marked, 1, __ATOMIC_ACQ_REL) != BOOT_PHASE_COUNT){
+        return;
+    }
+    printf("Boot:");
+    for(id = 0; id < BOOT_PHASE_COUNT; id++){
+        printf(" %s %lu.%lu ms%s", phase_names[id], (unsigned long)(phase_us[id] / 1000),
+               (unsigned long)(phase_us[id] % 1000 / 100), id < BOOT_PHASE_COUNT - 1 ? "," : "\n");
+    }
+}
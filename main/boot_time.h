@@ -0,0 +1,18 @@
+#ifndef BOOT_TIME_H
+#define BOOT_TIME_H
+
+// startup phases, in the order they normally finish
+typedef enum {
+    BOOT_APP_MAIN = 0,          // app_main entered
+    BOOT_INPUTS,                // seat, belt, ignition and indicator pins configured
+    BOOT_SERVO,                 // servo PWM running with the arm parked
+    BOOT_TASKS,                 // analog sampling, protection and the control and display tasks started
+    BOOT_READY,                 // first control pass done, ignition accepted from here on
+    BOOT_LCD,                   // LCD controller initialised by the display task
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+// record the time a phase finished (any task), the report is printed once every phase is in
+void boot_mark(boot_phase_t phase);
+
+#endif
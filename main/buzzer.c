@@ -0,0 +1,121 @@
+#include "buzzer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include "driver/ledc.h"
+#include "esp_timer.h"
+
+#define BUZZER_MODE         LEDC_LOW_SPEED_MODE     // same mode as the servo, which uses timer 0 and channel 0
+#define BUZZER_TIMER        LEDC_TIMER_1
+#define BUZZER_CHANNEL      LEDC_CHANNEL_1
+#define BUZZER_DUTY_RES     LEDC_TIMER_10_BIT
+#define BUZZER_DUTY_ON      (1 << (BUZZER_DUTY_RES - 1))    // 50% square wave
+#define BUZZER_HZ           (2700)      // piezo resonance, the loudest tone
+
+typedef struct {
+    uint16_t hz;                // tone, 0 for silence
+    uint16_t ms;                // length, 0 holds the note until the next buzzer_play()
+} buzzer_note_t;
+
+typedef struct {
+    const buzzer_note_t *notes;
+    int count;
+    bool repeat;                // start over after the last note (otherwise go silent)
+} buzzer_tune_t;
+
+static const buzzer_note_t chirp_notes[] = {
+    { 2000, 40 }, { BUZZER_HZ, 60 }, { 0, 80 }, { 2000, 40 }, { BUZZER_HZ, 60 }, { 0, 720 },
+};
+static const buzzer_note_t belt_notes[] = {
+    { BUZZER_HZ, 0 },
+};
+static const buzzer_note_t start_notes[] = {
+    { BUZZER_HZ, 120 },
+};
+
+static const buzzer_tune_t tunes[BUZZER_PATTERN_COUNT] = {
+    [BUZZER_OFF]   = { NULL, 0, false },
+    [BUZZER_CHIRP] = { chirp_notes, sizeof(chirp_notes) / sizeof(chirp_notes[0]), true },
+    [BUZZER_BELT]  = { belt_notes, 1, false },
+    [BUZZER_START] = { start_notes, 1, false },
+};
+
+static esp_timer_handle_t note_timer;
+static volatile buzzer_pattern_t requested;     // written by buzzer_play()
+static buzzer_pattern_t playing;                // the rest is only touched by note_timer's callback
+static int next_note;
+static int tone_hz;
+
+// play one note and arm the timer for its end, the only code that touches the LEDC channel
+static void buzzer_note(void *arg)
+{
+    if (playing != requested){
+        playing = requested;
+        next_note = 0;
+    }
+
+    const buzzer_tune_t *tune = &tunes[playing];
+    if (next_note == tune->count){
+        if (!tune->repeat || tune->count == 0){
+            ledc_set_duty(BUZZER_MODE, BUZZER_CHANNEL, 0);
+            ledc_update_duty(BUZZER_MODE, BUZZER_CHANNEL);
+            return;
+        }
+        next_note = 0;
+    }
+
+    const buzzer_note_t *note = &tune->notes[next_note++];
+    if (note->hz != 0 && note->hz != tone_hz){
+        ledc_set_freq(BUZZER_MODE, BUZZER_TIMER, note->hz);
+        tone_hz = note->hz;
+    }
+    ledc_set_duty(BUZZER_MODE, BUZZER_CHANNEL, note->hz != 0 ? BUZZER_DUTY_ON : 0);
+    ledc_update_duty(BUZZER_MODE, BUZZER_CHANNEL);
+    if (note->ms != 0){
+        esp_timer_start_once(note_timer, note->ms * 1000);
+    }
+}
+
+esp_err_t buzzer_init(gpio_num_t pin)
+{
+    ledc_timer_config_t timer = {
+        .speed_mode       = BUZZER_MODE,
+        .duty_resolution  = BUZZER_DUTY_RES,
+        .timer_num        = BUZZER_TIMER,
+        .freq_hz          = BUZZER_HZ,
+        .clk_cfg          = LEDC_AUTO_CLK       // must match the servo timer's clock in low speed mode
+    };
+    ledc_channel_config_t channel = {
+        .speed_mode     = BUZZER_MODE,
+        .channel        = BUZZER_CHANNEL,
+        .timer_sel      = BUZZER_TIMER,
+        .intr_type      = LEDC_INTR_DISABLE,
+        .gpio_num       = pin,
+        .duty           = 0,
+        .hpoint         = 0
+    };
+    esp_timer_create_args_t timer_args = {
+        .callback = buzzer_note,
+        .name = "buzzer",
+    };
+    esp_err_t err;
+
+    tone_hz = BUZZER_HZ;
+    err = ledc_timer_config(&timer);
+    if (err == ESP_OK){
+        err = ledc_channel_config(&channel);
+    }
+    if (err == ESP_OK){
+        err = esp_timer_create(&timer_args, &note_timer);
+    }
+    return err;
+}
+
+// the note timer's callback picks up the new pattern right away
+void buzzer_play(buzzer_pattern_t pattern)
+{
+    requested = pattern;
+    esp_timer_stop(note_timer);
+    while (esp_timer_start_once(note_timer, 0) == ESP_ERR_INVALID_STATE){
+        esp_timer_stop(note_timer);     // the callback re-armed it in between
+    }
+}
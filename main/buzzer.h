@@ -0,0 +1,25 @@
+#ifndef BUZZER_H
+#define BUZZER_H
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+// Alarm buzzer patterns on their own LEDC timer and channel. The LEDC hardware makes the
+// tone, and a one-shot esp_timer moves to the next note, so a playing pattern costs one
+// short callback per note and nothing in between. Made for a passive piezo buzzer.
+
+typedef enum {
+    BUZZER_OFF = 0,             // silence
+    BUZZER_CHIRP,               // ignition inhibited: two rising chirps, repeated
+    BUZZER_BELT,                // seatbelts not fastened: continuous tone
+    BUZZER_START,               // engine started: one short beep
+    BUZZER_PATTERN_COUNT
+} buzzer_pattern_t;
+
+// set up LEDC timer 1 and channel 1 on pin, silent
+esp_err_t buzzer_init(gpio_num_t pin);
+
+// start a pattern (any task), replacing the one playing, returns at once
+void buzzer_play(buzzer_pattern_t pattern);
+
+#endif
@@ -0,0 +1,366 @@
+#include "can_bus.h"
+#include "freertos/FreeRTOS.h"
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#if CONFIG_WIPER_CAN_BUS
+
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_twai.h"
+#include "esp_twai_onchip.h"
+#include "health.h"
+#include "event_bus.h"
+
+#define CAN_POLL_MS         (10)        // longest wait for a received frame between batches
+#define CAN_RX_QUEUE_LEN    (16)        // frames buffered between the RX interrupt and the bus task
+#define CAN_TASK_STACK      (3072)
+#define CAN_FRAME_BITS(len) (47 + 8 * (len))   // standard data frame plus interframe space, no stuffing
+
+// transmit frames, each owned by the driver from twai_node_transmit() until its TX done interrupt
+typedef enum {
+    CAN_TX_ENGINE = 0,
+    CAN_TX_OCCUPANCY,
+    CAN_TX_WIPER,
+    CAN_TX_SELF_TEST,
+    CAN_TX_COUNT
+} can_tx_slot_t;
+
+static const uint32_t tx_ids[CAN_TX_COUNT] = {
+    [CAN_TX_ENGINE]     = CAN_ID_ENGINE,
+    [CAN_TX_OCCUPANCY]  = CAN_ID_OCCUPANCY,
+    [CAN_TX_WIPER]      = CAN_ID_WIPER,
+    [CAN_TX_SELF_TEST]  = CAN_ID_WIPER_CMD,
+};
+
+typedef struct {
+    uint32_t id;
+    uint8_t len;
+    uint8_t data[8];
+} can_rx_msg_t;
+
+typedef struct {
+    volatile uint32_t tx_frames;        // frames acknowledged on the bus
+    volatile uint32_t tx_failed;        // frames the controller gave up on
+    uint32_t tx_skipped;                // periodic frames skipped because the last copy was still queued
+    uint32_t batches;                   // bus task passes that queued at least one frame
+    volatile uint32_t rx_frames;
+    volatile uint32_t rx_overruns;      // frames lost because the RX queue was full
+    volatile uint32_t bus_errors;
+    volatile uint32_t bus_bits;         // bits on the wire in the current load window
+    uint32_t load_permille;             // bus load over the last second
+    uint32_t peak_load_permille;
+} can_stats_t;
+
+static twai_node_handle_t node;
+static QueueHandle_t rx_queue;
+#if CONFIG_WIPER_STATIC_ALLOC
+static uint8_t rx_queue_storage[CAN_RX_QUEUE_LEN * sizeof(can_rx_msg_t)];
+static StaticQueue_t rx_queue_buf;
+static StackType_t can_stack[CAN_TASK_STACK];
+static StaticTask_t can_tcb;
+#endif
+static twai_frame_t tx_frames[CAN_TX_COUNT];
+static uint8_t tx_data[CAN_TX_COUNT][8];
+static volatile bool tx_busy[CAN_TX_COUNT];
+static volatile bool bus_off;
+static can_stats_t stats;
+
+static can_bus_state_t published;       // latest state from the control task
+static bool command_active;             // a wiper command from the bus is in force
+static int command_mode;
+static int command_int;
+static TickType_t command_tick;         // when the command was last received
+static portMUX_TYPE can_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void can_task(void *pvParameter);
+
+static const health_spec_t can_spec = {
+    .name = "CAN_Task", .entry = can_task, .stack = CAN_TASK_STACK, .priority = 4, .deadline_ms = 500,
+#if CONFIG_WIPER_STATIC_ALLOC
+    .stack_buf = can_stack, .tcb = &can_tcb,
+#endif
+};
+
+// TX done interrupt: hand the frame back to the bus task
+static bool IRAM_ATTR can_tx_done(twai_node_handle_t handle, const twai_tx_done_event_data_t *edata, void *user_ctx)
+{
+    int slot = edata->done_tx_frame - tx_frames;
+
+    if (edata->is_tx_success){
+        stats.tx_frames++;
+        stats.bus_bits += CAN_FRAME_BITS(edata->done_tx_frame->buffer_len);
+    }
+    else{
+        stats.tx_failed++;
+    }
+    if (slot >= 0 && slot < CAN_TX_COUNT){
+        tx_busy[slot] = false;
+    }
+    return false;
+}
+
+// RX done interrupt: copy the frame out of the controller and queue it for the bus task
+static bool IRAM_ATTR can_rx_done(twai_node_handle_t handle, const twai_rx_done_event_data_t *edata, void *user_ctx)
+{
+    can_rx_msg_t msg;
+    twai_frame_t frame = {
+        .buffer = msg.data,
+        .buffer_len = sizeof(msg.data),
+    };
+    BaseType_t woken = pdFALSE;
+
+    if (twai_node_receive_from_isr(handle, &frame) == ESP_OK){
+        msg.id = frame.header.id;
+        msg.len = frame.header.dlc > 8 ? 8 : frame.header.dlc;
+        stats.rx_frames++;
+        stats.bus_bits += CAN_FRAME_BITS(msg.len);
+        if (xQueueSendFromISR(rx_queue, &msg, &woken) != pdTRUE){
+            stats.rx_overruns++;
+        }
+    }
+    return woken == pdTRUE;
+}
+
+static bool IRAM_ATTR can_error(twai_node_handle_t handle, const twai_error_event_data_t *edata, void *user_ctx)
+{
+    stats.bus_errors++;
+    return false;
+}
+
+static bool IRAM_ATTR can_state_change(twai_node_handle_t handle, const twai_state_change_event_data_t *edata, void *user_ctx)
+{
+    if (edata->new_sta == TWAI_ERROR_BUS_OFF){
+        bus_off = true;
+    }
+    return false;
+}
+
+// queue one frame if it changed or is due, returns 1 if it was queued
+static int can_send(can_tx_slot_t slot, const uint8_t *payload, int len, bool periodic)
+{
+    if (tx_busy[slot]){
+        if (periodic){
+            stats.tx_skipped++;
+        }
+        return 0;               // a changed frame goes out on a later pass
+    }
+    if (!periodic && tx_frames[slot].buffer_len == (size_t)len && memcmp(tx_data[slot], payload, len) == 0){
+        return 0;
+    }
+
+    memcpy(tx_data[slot], payload, len);
+    tx_frames[slot].header.id = tx_ids[slot];
+    tx_frames[slot].header.dlc = len;
+    tx_frames[slot].buffer = tx_data[slot];
+    tx_frames[slot].buffer_len = len;
+    tx_busy[slot] = true;
+    if (twai_node_transmit(node, &tx_frames[slot], 0) != ESP_OK){
+        tx_busy[slot] = false;
+        stats.tx_failed++;
+        return 0;
+    }
+    return 1;
+}
+
+// act on a received frame
+static void can_receive(const can_rx_msg_t *msg)
+{
+    if (msg->id != CAN_ID_WIPER_CMD || msg->len < 1){
+        return;                 // other nodes' traffic (or our own echoes in loopback)
+    }
+
+    portENTER_CRITICAL(&can_lock);
+    if (msg->data[0] == CAN_WIPER_RELEASE){
+        command_active = false;
+    }
+    else if (msg->data[0] <= 3){
+        command_active = true;
+        command_mode = msg->data[0];
+        command_int = (msg->len >= 2 && msg->data[1] >= 1 && msg->data[1] <= 3) ? msg->data[1] : 1;
+        command_tick = xTaskGetTickCount();
+    }
+    portEXIT_CRITICAL(&can_lock);
+
+    // wake the control task, which picks the command up through can_bus_wiper_command()
+    bus_event_t event = {
+        .topic = BUS_CAN_COMMAND,
+        .can_command = { .mode = msg->data[0] <= 3 ? msg->data[0] : -1, .wiper_int = msg->len >= 2 ? msg->data[1] : 0 },
+    };
+    bus_publish(&event);
+}
+
+#if CONFIG_WIPER_CAN_LOOPBACK
+// send a harmless release command to ourselves and check it comes back through the RX path
+static void can_self_test(void)
+{
+    static const uint8_t release[1] = { CAN_WIPER_RELEASE };
+    can_rx_msg_t msg;
+    TickType_t start = xTaskGetTickCount();
+
+    can_send(CAN_TX_SELF_TEST, release, sizeof(release), true);
+    while (xTaskGetTickCount() - start < pdMS_TO_TICKS(100)){
+        if (xQueueReceive(rx_queue, &msg, pdMS_TO_TICKS(CAN_POLL_MS)) == pdTRUE && msg.id == CAN_ID_WIPER_CMD){
+            can_receive(&msg);
+            printf("CAN loopback self-test passed.\n");
+            return;
+        }
+    }
+    printf("CAN loopback self-test failed: no echo.\n");
+}
+#endif
+
+// Task to batch state frames onto the bus and handle received commands
+static void can_task(void *pvParameter)
+{
+    can_rx_msg_t msg;
+    can_bus_state_t state;
+    TickType_t last_periodic = xTaskGetTickCount();
+    TickType_t window_start = last_periodic;
+
+#if CONFIG_WIPER_CAN_LOOPBACK
+    can_self_test();
+#endif
+
+    while (1){
+        health_beat(HEALTH_CAN);
+
+        // wait for a frame, then drain whatever else has arrived
+        if (xQueueReceive(rx_queue, &msg, pdMS_TO_TICKS(CAN_POLL_MS)) == pdTRUE){
+            do {
+                can_receive(&msg);
+            } while (xQueueReceive(rx_queue, &msg, 0) == pdTRUE);
+        }
+
+        if (bus_off){
+            bus_off = false;
+            printf("CAN bus off, recovering.\n");
+            twai_node_recover(node);
+        }
+
+        portENTER_CRITICAL(&can_lock);
+        state = published;
+        portEXIT_CRITICAL(&can_lock);
+
+        // queue every changed frame (and all of them once per period) back to back
+        TickType_t now = xTaskGetTickCount();
+        bool periodic = now - last_periodic >= pdMS_TO_TICKS(CONFIG_WIPER_CAN_PERIOD_MS);
+        if (periodic){
+            last_periodic = now;
+        }
+        uint8_t engine[2] = { state.engine, state.ready };
+        uint8_t occupancy[1] = { state.occupancy };
+        uint8_t wiper[3] = { state.wiper, state.wiper_int, state.fault };
+        int queued = can_send(CAN_TX_ENGINE, engine, sizeof(engine), periodic)
+                   + can_send(CAN_TX_OCCUPANCY, occupancy, sizeof(occupancy), periodic)
+                   + can_send(CAN_TX_WIPER, wiper, sizeof(wiper), periodic);
+        if (queued > 0){
+            stats.batches++;
+        }
+
+        // bus load over one second windows
+        if (now - window_start >= pdMS_TO_TICKS(1000)){
+            stats.load_permille = (uint32_t)((uint64_t)stats.bus_bits * 1000 / CONFIG_WIPER_CAN_BITRATE);
+            if (stats.load_permille > stats.peak_load_permille){
+                stats.peak_load_permille = stats.load_permille;
+            }
+            stats.bus_bits = 0;
+            window_start = now;
+        }
+    }
+}
+
+esp_err_t can_bus_init(void)
+{
+    twai_onchip_node_config_t node_config = {
+        .io_cfg = {
+            .tx = CONFIG_WIPER_CAN_TX_GPIO,
+            .rx = CONFIG_WIPER_CAN_RX_GPIO,
+            .quanta_clk_out = -1,
+            .bus_off_indicator = -1,
+        },
+        .bit_timing.bitrate = CONFIG_WIPER_CAN_BITRATE,
+        .tx_queue_depth = CAN_TX_COUNT,
+#if CONFIG_WIPER_CAN_LOOPBACK
+        .flags.enable_self_test = true,     // no other node needs to acknowledge
+        .flags.enable_loopback = true,      // receive our own frames
+#endif
+    };
+    twai_event_callbacks_t callbacks = {
+        .on_tx_done = can_tx_done,
+        .on_rx_done = can_rx_done,
+        .on_error = can_error,
+        .on_state_change = can_state_change,
+    };
+    esp_err_t err;
+
+#if CONFIG_WIPER_STATIC_ALLOC
+    rx_queue = xQueueCreateStatic(CAN_RX_QUEUE_LEN, sizeof(can_rx_msg_t), rx_queue_storage, &rx_queue_buf);
+#else
+    rx_queue = xQueueCreate(CAN_RX_QUEUE_LEN, sizeof(can_rx_msg_t));
+#endif
+    if (rx_queue == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    err = twai_new_node_onchip(&node_config, &node);
+    if (err == ESP_OK){
+        err = twai_node_register_event_callbacks(node, &callbacks, NULL);
+    }
+    if (err == ESP_OK){
+        err = twai_node_enable(node);
+    }
+    if (err != ESP_OK){
+        return err;
+    }
+
+    health_start(HEALTH_CAN, &can_spec);
+    return ESP_OK;
+}
+
+void can_bus_publish(const can_bus_state_t *state)
+{
+    portENTER_CRITICAL(&can_lock);
+    published = *state;
+    portEXIT_CRITICAL(&can_lock);
+}
+
+bool can_bus_wiper_command(int *mode, int *wiper_int)
+{
+    bool active;
+
+    portENTER_CRITICAL(&can_lock);
+    if (command_active && xTaskGetTickCount() - command_tick > pdMS_TO_TICKS(CONFIG_WIPER_CAN_CMD_TIMEOUT_MS)){
+        command_active = false;     // the commanding node went quiet, back to the knobs
+    }
+    active = command_active;
+    if (active){
+        *mode = command_mode;
+        *wiper_int = command_int;
+    }
+    portEXIT_CRITICAL(&can_lock);
+
+    return active;
+}
+
+void can_bus_print_stats(void)
+{
+    printf("CAN: tx %" PRIu32 " (failed %" PRIu32 ", skipped %" PRIu32 ") in %" PRIu32 " batches, "
+           "rx %" PRIu32 " (overruns %" PRIu32 "), bus errors %" PRIu32 ", load %" PRIu32 ".%" PRIu32 "%% "
+           "(peak %" PRIu32 ".%" PRIu32 "%%)\n",
+           stats.tx_frames, stats.tx_failed, stats.tx_skipped, stats.batches,
+           stats.rx_frames, stats.rx_overruns, stats.bus_errors,
+           stats.load_permille / 10, stats.load_permille % 10,
+           stats.peak_load_permille / 10, stats.peak_load_permille % 10);
+}
+
+#else
+
+esp_err_t can_bus_init(void) { return ESP_OK; }
+void can_bus_publish(const can_bus_state_t *state) {}
+bool can_bus_wiper_command(int *mode, int *wiper_int) { return false; }
+void can_bus_print_stats(void) {}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef CAN_BUS_H
+#define CAN_BUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// TWAI (CAN) vehicle bus node (CONFIG_WIPER_CAN_BUS).
+// With the bus disabled every call is a no-op and no wiper command is ever reported.
+
+// standard 11-bit frame identifiers
+#define CAN_ID_ENGINE       (0x310)     // tx: [0] ignition state (executed), [1] ready LED
+#define CAN_ID_OCCUPANCY    (0x311)     // tx: [0] CAN_SEAT_* bits
+#define CAN_ID_WIPER        (0x312)     // tx: [0] wiper mode, [1] intermittence, [2] wiper_fault_t
+#define CAN_ID_WIPER_CMD    (0x320)     // rx: [0] wiper mode or CAN_WIPER_RELEASE, [1] intermittence
+
+#define CAN_SEAT_DRIVER     (1 << 0)
+#define CAN_SEAT_PASSENGER  (1 << 1)
+#define CAN_BELT_DRIVER     (1 << 2)
+#define CAN_BELT_PASSENGER  (1 << 3)
+
+#define CAN_WIPER_RELEASE   (0xFF)      // hand the wipers back to the knobs
+
+// state published on the bus, one byte per field
+typedef struct {
+    uint8_t engine;             // ignition state machine value (executed)
+    uint8_t ready;              // ready LED on
+    uint8_t occupancy;          // CAN_SEAT_* / CAN_BELT_* bits
+    uint8_t wiper;              // 0 OFF, 1 INT, 2 LOW, 3 HIGH
+    uint8_t wiper_int;          // 1 SHORT, 2 MED, 3 LONG
+    uint8_t fault;              // wiper_fault_t
+} can_bus_state_t;
+
+// start the TWAI node and the bus task
+esp_err_t can_bus_init(void);
+
+// hand the latest state to the bus task, changed frames go out on its next pass
+void can_bus_publish(const can_bus_state_t *state);
+
+// wiper command received from the bus, false when none is active (released or timed out)
+bool can_bus_wiper_command(int *mode, int *wiper_int);
+
+// print frame counts, errors and bus load
+void can_bus_print_stats(void);
+
+#endif
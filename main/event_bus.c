@@ -0,0 +1,112 @@
+#include "event_bus.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+typedef struct {
+    uint32_t topics;
+    bus_listener_t listener;
+    void *ctx;
+} bus_listen_entry_t;
+
+static bus_subscriber_t *subscribers[BUS_MAX_SUBSCRIBERS];
+static int subscriber_count;
+static bus_listen_entry_t listeners[BUS_MAX_LISTENERS];
+static int listener_count;
+
+esp_err_t bus_subscribe(bus_subscriber_t *sub, uint32_t topics)
+{
+    if (subscriber_count >= BUS_MAX_SUBSCRIBERS){
+        return ESP_ERR_NO_MEM;
+    }
+    sub->topics = topics;
+    sub->wake = xSemaphoreCreateBinaryStatic(&sub->wake_buf);
+    subscribers[subscriber_count++] = sub;
+    return ESP_OK;
+}
+
+esp_err_t bus_listen(uint32_t topics, bus_listener_t listener, void *ctx)
+{
+    if (listener_count >= BUS_MAX_LISTENERS){
+        return ESP_ERR_NO_MEM;
+    }
+    listeners[listener_count++] = (bus_listen_entry_t){ .topics = topics, .listener = listener, .ctx = ctx };
+    return ESP_OK;
+}
+
+// producer side of a ring, false if the subscriber has fallen BUS_RING_SIZE events behind
+static bool IRAM_ATTR bus_ring_push(bus_ring_t *ring, const bus_event_t *event)
+{
+    uint32_t head = ring->head;
+
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= BUS_RING_SIZE){
+        return false;
+    }
+    ring->events[head % BUS_RING_SIZE] = *event;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);     // event visible before the new head
+    return true;
+}
+
+// consumer side of a ring
+static bool bus_ring_pop(bus_ring_t *ring, bus_event_t *event)
+{
+    uint32_t tail = ring->tail;
+
+    if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)){
+        return false;
+    }
+    *event = ring->events[tail % BUS_RING_SIZE];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);     // slot free only after the copy
+    return true;
+}
+
+void bus_publish(bus_event_t *event)
+{
+    event->time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    for (int i = 0; i < subscriber_count; i++){
+        bus_subscriber_t *sub = subscribers[i];
+        if (sub->topics & BUS_MASK(event->topic)){
+            if (!bus_ring_push(&sub->rings[event->topic], event)){
+                sub->dropped++;
+            }
+            xSemaphoreGive(sub->wake);
+        }
+    }
+    for (int i = 0; i < listener_count; i++){
+        if (listeners[i].topics & BUS_MASK(event->topic)){
+            listeners[i].listener(event, listeners[i].ctx);
+        }
+    }
+}
+
+void IRAM_ATTR bus_publish_from_isr(bus_event_t *event, BaseType_t *woken)
+{
+    event->time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    for (int i = 0; i < subscriber_count; i++){
+        bus_subscriber_t *sub = subscribers[i];
+        if (sub->topics & BUS_MASK(event->topic)){
+            if (!bus_ring_push(&sub->rings[event->topic], event)){
+                sub->dropped++;
+            }
+            xSemaphoreGiveFromISR(sub->wake, woken);
+        }
+    }
+}
+
+bool bus_receive(bus_subscriber_t *sub, bus_event_t *event, TickType_t timeout)
+{
+    while (1){
+        for (int i = 0; i < BUS_TOPIC_COUNT; i++){
+            int topic = (sub->next_topic + i) % BUS_TOPIC_COUNT;
+            if ((sub->topics & BUS_MASK(topic)) && bus_ring_pop(&sub->rings[topic], event)){
+                sub->next_topic = (topic + 1) % BUS_TOPIC_COUNT;
+                return true;
+            }
+        }
+        // a give after the rings were checked leaves the semaphore set, so no event is missed
+        if (xSemaphoreTake(sub->wake, timeout) != pdTRUE){
+            return false;
+        }
+    }
+}
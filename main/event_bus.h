@@ -0,0 +1,95 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+
+/* Typed publish/subscribe between the firmware's tasks. Every topic has exactly one
+producer (a task or an ISR), and each task subscriber keeps one single-producer,
+single-consumer ring per topic, so publishing and receiving take no locks. Listeners
+are called directly in the publishing task. Everything is statically allocated:
+subscribers are declared by their owners, and all registration happens before the
+producers start. */
+
+#define BUS_RING_SIZE       (8)     // events queued per topic per subscriber (power of two)
+#define BUS_MAX_SUBSCRIBERS (4)     // task subscribers
+#define BUS_MAX_LISTENERS   (8)     // direct listeners
+
+typedef enum {
+    BUS_INPUTS = 0,             // seat, belt or ignition GPIO changed (GPIO ISR)
+    BUS_KNOB,                   // wiper or intermittence knob moved (analog task)
+    BUS_CAN_COMMAND,            // wiper command or release from the CAN bus (CAN task)
+    BUS_FAULT,                  // wiper motor cut off (protection task)
+    BUS_VEHICLE,                // ignition state or wiper setting changed (control task)
+    BUS_TOPIC_COUNT
+} bus_topic_t;
+
+#define BUS_MASK(topic)     (1u << (topic))
+
+// BUS_INPUTS bits, set while the button or switch is closed
+#define BUS_INPUT_DSEAT     (1 << 0)
+#define BUS_INPUT_PSEAT     (1 << 1)
+#define BUS_INPUT_DBELT     (1 << 2)
+#define BUS_INPUT_PBELT     (1 << 3)
+#define BUS_INPUT_IGNITION  (1 << 4)
+
+typedef struct {
+    uint8_t engine;             // ignition state machine value (executed)
+    uint8_t ready;              // ready LED on
+    uint8_t inputs;             // BUS_INPUT_* bits the state was computed from
+    uint8_t wiper;              // 0 OFF, 1 INT, 2 LOW, 3 HIGH
+    uint8_t wiper_int;          // 1 SHORT, 2 MED, 3 LONG
+    uint8_t fault;              // wiper_fault_t
+    uint8_t speed_band;         // wheel speed band, index into the servo_speed_* tables
+    uint8_t int_delay_ds;       // INT dwell at standstill, in 100 ms units
+} bus_vehicle_t;
+
+typedef struct {
+    uint8_t topic;              // bus_topic_t
+    uint32_t time_ms;           // ms since boot when published
+    union {
+        uint8_t inputs;                                 // BUS_INPUTS
+        struct { uint8_t input; int16_t mv; } knob;     // BUS_KNOB: analog_in_t and filtered reading
+        struct { int8_t mode; uint8_t wiper_int; } can_command;    // BUS_CAN_COMMAND: mode -1 = release
+        uint8_t fault;                                  // BUS_FAULT: wiper_fault_t
+        bus_vehicle_t vehicle;                          // BUS_VEHICLE
+    };
+} bus_event_t;
+
+typedef struct {
+    bus_event_t events[BUS_RING_SIZE];
+    volatile uint32_t head;     // advanced by the producer only
+    volatile uint32_t tail;     // advanced by the consumer only
+} bus_ring_t;
+
+// a task that receives events, declared static by its owner
+typedef struct {
+    uint32_t topics;            // BUS_MASK() bits
+    bus_ring_t rings[BUS_TOPIC_COUNT];
+    SemaphoreHandle_t wake;
+    StaticSemaphore_t wake_buf;
+    int next_topic;             // topic drained first next time, so a busy one can't starve the others
+    uint32_t dropped;           // events lost to full rings
+} bus_subscriber_t;
+
+typedef void (*bus_listener_t)(const bus_event_t *event, void *ctx);
+
+// register a task subscriber for the topics in mask, ESP_ERR_NO_MEM if every slot is taken
+esp_err_t bus_subscribe(bus_subscriber_t *sub, uint32_t topics);
+
+// register a listener called in the publisher's task for the topics in mask (not for ISR topics)
+esp_err_t bus_listen(uint32_t topics, bus_listener_t listener, void *ctx);
+
+// publish from the topic's producer task, event->topic selects the topic
+void bus_publish(bus_event_t *event);
+
+// publish from the topic's producer ISR
+void bus_publish_from_isr(bus_event_t *event, BaseType_t *woken);
+
+// take the next event for this subscriber, waiting up to timeout ticks, false on timeout
+bool bus_receive(bus_subscriber_t *sub, bus_event_t *event, TickType_t timeout);
+
+#endif
@@ -0,0 +1,60 @@
+#include "event_log.h"
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>
+#include <inttypes.h>
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+#define EVENT_LOG_SIZE  (32)    // entries kept, oldest overwritten first
+
+static const char *event_names[EVENT_COUNT] = {
+    [EVENT_WIPER_FAULT]         = "wiper fault",
+    [EVENT_WIPER_FAULT_CLEARED] = "wiper fault cleared",
+    [EVENT_TASK_RESTART]        = "task restarted",
+    [EVENT_STACK_LOW]           = "task stack low",
+    [EVENT_ENGINE_STATE]        = "engine state",
+    [EVENT_WIPER_MODE]          = "wiper mode",
+};
+
+static event_t event_log[EVENT_LOG_SIZE];
+static uint32_t event_head;     // total events ever added
+static portMUX_TYPE event_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void IRAM_ATTR event_log_add(event_id_t id, int32_t value)
+{
+    event_t event = {
+        .time_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .id = id,
+        .value = value,
+    };
+
+    portENTER_CRITICAL_SAFE(&event_lock);
+    event_log[event_head % EVENT_LOG_SIZE] = event;
+    event_head++;
+    portEXIT_CRITICAL_SAFE(&event_lock);
+}
+
+int event_log_read(event_t *out, int max)
+{
+    int count = 0;
+
+    portENTER_CRITICAL(&event_lock);
+    uint32_t first = event_head > EVENT_LOG_SIZE ? event_head - EVENT_LOG_SIZE : 0;
+    for (uint32_t i = first; i < event_head && count < max; i++){
+        out[count++] = event_log[i % EVENT_LOG_SIZE];
+    }
+    portEXIT_CRITICAL(&event_lock);
+
+    return count;
+}
+
+void event_log_print(void)
+{
+    static event_t events[EVENT_LOG_SIZE];  // off the caller's stack, printed from the control task
+    int count = event_log_read(events, EVENT_LOG_SIZE);
+
+    printf("Event log: last %d of %" PRIu32 " events\n", count, event_head);
+    for (int i = 0; i < count; i++){
+        printf("%8" PRIu32 " ms  %s (%" PRId32 ")\n", events[i].time_ms, event_names[events[i].id], events[i].value);
+    }
+}
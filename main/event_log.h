@@ -0,0 +1,32 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+
+// events recorded in the in-RAM event log
+typedef enum {
+    EVENT_WIPER_FAULT = 0,      // wiper motor cut off, value = wiper_fault_t
+    EVENT_WIPER_FAULT_CLEARED,  // wiper fault reset from the knob, value = wiper_fault_t
+    EVENT_TASK_RESTART,         // task missed its heartbeat deadline, value = health_task_t
+    EVENT_STACK_LOW,            // task stack nearly used up, value = health_task_t
+    EVENT_ENGINE_STATE,         // ignition state machine moved, value = executed
+    EVENT_WIPER_MODE,           // wiper setting changed with the engine running, value = wiper * 10 + wiper_int
+    EVENT_COUNT
+} event_id_t;
+
+typedef struct {
+    uint32_t time_ms;           // ms since boot
+    uint16_t id;                // event_id_t
+    int32_t value;              // event specific value
+} event_t;
+
+// record an event (task or ISR context), the oldest entry is overwritten when full
+void event_log_add(event_id_t id, int32_t value);
+
+// copy up to max entries, oldest first, returns the number copied
+int event_log_read(event_t *out, int max);
+
+// print the whole log to the console
+void event_log_print(void);
+
+#endif
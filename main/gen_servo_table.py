@@ -0,0 +1,215 @@
+#!/usr/bin/env python
+"""Generate the wiper servo duty tables (servo_table.c/.h) at build time.
+
+Each wiper speed gets one const fade plan for a 0 to 90 degree half-sweep: at most
+two LEDC hardware fade segments that together move the full duty range in a whole
+number of PWM periods. The wiper task only copies the plan into the fade engine and
+does no arithmetic on the LEDC timing at runtime. Called from main/CMakeLists.txt
+with the values chosen in menuconfig.
+
+With a wheel speed input there is one plan per speed band, the sweep rate rising
+linearly to --speed-gain-pct more at --speed-max-kmh, and the INT dwell shrinking in
+proportion. The bands are looked up from the wheel pulses counted over the speed
+window, so turning pulses into a sweep rate takes no division at runtime either.
+"""
+import argparse
+import math
+import os
+import sys
+
+LEDC_MAX_DUTY_RES = 14  # widest LEDC timer on the ESP32-S3
+LEDC_MAX_FADE_FIELD = 1023  # scale, cycle_num and step count are 10-bit fields
+SPEED_STEP_KMH = 5          # width of a speed band
+SPEED_SAMPLE_MS = 250       # wheel pulse count period
+SPEED_WINDOW = 4            # pulse counts summed for the speed estimate (1 s)
+
+
+def auto_duty_res(clk_hz, freq_hz):
+    """Widest duty resolution the LEDC clock can divide down to freq_hz."""
+    res = LEDC_MAX_DUTY_RES
+    while res > 1 and clk_hz < freq_hz * (1 << res):
+        res -= 1
+    return res
+
+
+def duty_counts(pulse_us, freq_hz, duty_res):
+    """Duty counts for a servo pulse width, rounded to the nearest count."""
+    period_us = 1000000 / freq_hz
+    return int(round(pulse_us * (1 << duty_res) / period_us))
+
+
+def fade_plan(delta, periods):
+    """Split a duty change over a number of PWM periods into two (scale, cycle_num, steps) fade segments.
+
+    Mirrors servo_fade_plan() in wiper_engine.c, which re-plans shortened ramps at runtime.
+    """
+    if delta >= periods:
+        # one or more counts every period
+        q, r = divmod(delta, periods)
+        return [(q + 1, 1, r), (q, 1, periods - r)]
+    # one count every few periods
+    q, r = divmod(periods, delta)
+    return [(1, q + 1, r), (1, q, delta - r)]
+
+
+def profile(name, rpm, span, freq_hz, warn=True):
+    """Fade plan for one speed moving span duty counts in one half-sweep."""
+    # one out-and-back sweep is half a revolution of the wiper shaft
+    half_period_ms = 15000.0 / rpm
+    periods = max(1, int(round(half_period_ms * freq_hz / 1000)))
+    if warn and periods * 1000.0 / freq_hz != half_period_ms:
+        sys.stderr.write('gen_servo_table: %s speed %d rpm rounds to a %g ms half-period (%d PWM periods)\n'
+                         % (name, rpm, periods * 1000.0 / freq_hz, periods))
+    plan = fade_plan(span, periods)
+    for scale, cycle_num, steps in plan:
+        if max(scale, cycle_num, steps) > LEDC_MAX_FADE_FIELD:
+            raise ValueError('%s speed does not fit the LEDC fade engine' % name)
+    return periods, int(periods * 1000 // freq_hz), plan
+
+
+def speed_bands(max_kmh, gain_pct, pulses_per_km):
+    """(km/h, sweep rate factor, first pulse count of the window) for each speed band.
+
+    A band applies from halfway between its speed and the one below.
+    """
+    if not (max_kmh and gain_pct and pulses_per_km):
+        return [(0, 1.0, 0)]
+    bands = []
+    for band in range(max_kmh // SPEED_STEP_KMH + 1):
+        kmh = band * SPEED_STEP_KMH
+        factor = 1.0 + gain_pct / 100.0 * kmh / max_kmh
+        from_kmh = max(kmh - SPEED_STEP_KMH / 2.0, 0)
+        pulses = int(math.ceil(from_kmh * pulses_per_km * SPEED_SAMPLE_MS * SPEED_WINDOW / 3600000.0))
+        bands.append((kmh, factor, pulses))
+    if bands[-1][2] > 0xffff:
+        raise ValueError('%d pulses/km at %d km/h overflow the speed table' % (pulses_per_km, max_kmh))
+    return bands
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--out-dir', required=True)
+    parser.add_argument('--freq-hz', type=int, required=True)
+    parser.add_argument('--clk-hz', type=int, required=True)
+    parser.add_argument('--duty-res', type=int, required=True, help='0 picks the widest the clock allows')
+    parser.add_argument('--park-us', type=int, required=True)
+    parser.add_argument('--full-us', type=int, required=True)
+    parser.add_argument('--low-rpm', type=int, required=True)
+    parser.add_argument('--high-rpm', type=int, required=True)
+    parser.add_argument('--speed-max-kmh', type=int, default=0, help='top of the speed tables, 0 for no speed input')
+    parser.add_argument('--speed-gain-pct', type=int, default=0, help='extra sweep rate at the top speed')
+    parser.add_argument('--pulses-per-km', type=int, default=0, help='wheel speed pulses per km')
+    args = parser.parse_args()
+
+    duty_res = args.duty_res or auto_duty_res(args.clk_hz, args.freq_hz)
+    if not 1 <= duty_res <= LEDC_MAX_DUTY_RES:
+        parser.error('duty resolution must be 1..%d bits' % LEDC_MAX_DUTY_RES)
+    if args.clk_hz < args.freq_hz * (1 << duty_res):
+        parser.error('a %d Hz LEDC clock cannot make %d Hz at %d bits' % (args.clk_hz, args.freq_hz, duty_res))
+
+    park = duty_counts(args.park_us, args.freq_hz, duty_res)
+    full = duty_counts(args.full_us, args.freq_hz, duty_res)
+    if not 0 < park < full < (1 << duty_res):
+        parser.error('servo pulse widths do not fit a %d bit duty' % duty_res)
+
+    speeds = [('low', args.low_rpm), ('high', args.high_rpm)]
+    try:
+        bands = speed_bands(args.speed_max_kmh, args.speed_gain_pct, args.pulses_per_km)
+    except ValueError as e:
+        parser.error(str(e))
+
+    header = [
+        '// generated by gen_servo_table.py from menuconfig, do not edit',
+        '#ifndef SERVO_TABLE_H',
+        '#define SERVO_TABLE_H',
+        '',
+        '#include <stdint.h>',
+        '',
+        '#define SERVO_FREQUENCY_HZ  (%d)' % args.freq_hz,
+        '#define SERVO_DUTY_RES      (%d)' % duty_res,
+        '#define SERVO_DUTY_PARK     (%d)  // %d us, 0 degrees' % (park, args.park_us),
+        '#define SERVO_DUTY_FULL     (%d)  // %d us, 90 degrees' % (full, args.full_us),
+        '',
+        '// one LEDC hardware fade segment: steps of scale counts, each held for cycle_num PWM periods',
+        'typedef struct {',
+        '    uint16_t scale;',
+        '    uint16_t cycle_num;',
+        '    uint16_t steps;',
+        '} servo_fade_t;',
+        '',
+        '// fade plan for a 0 to 90 degree half-sweep at one speed (run backwards for 90 to 0)',
+        'typedef struct {',
+        '    servo_fade_t fade[2];       // segments in outward order, a segment may have 0 steps',
+        '    uint16_t periods;           // PWM periods per half-sweep',
+        '    uint16_t half_period_ms;    // periods * PWM period',
+        '} servo_profile_t;',
+        '',
+        '// wheel speed bands, band 0 is the vehicle at standstill',
+        '#define SERVO_SPEED_BANDS       (%d)' % len(bands),
+        '#define SERVO_SPEED_STEP_KMH    (%d)' % SPEED_STEP_KMH,
+        '#define SERVO_SPEED_SAMPLE_MS   (%d)    // wheel pulse count period' % SPEED_SAMPLE_MS,
+        '#define SERVO_SPEED_WINDOW      (%d)      // pulse counts summed for the speed estimate' % SPEED_WINDOW,
+        '',
+    ]
+    source = [
+        '// generated by gen_servo_table.py from menuconfig, do not edit',
+        '#include "servo_table.h"',
+        '',
+    ]
+
+    for name, rpm in speeds:
+        header.append('extern const servo_profile_t servo_speed_%s[SERVO_SPEED_BANDS];  // %d rpm at standstill'
+                      % (name, rpm))
+        source.append('const servo_profile_t servo_speed_%s[SERVO_SPEED_BANDS] = {' % name)
+        for kmh, factor, pulses in bands:
+            try:
+                periods, half_period_ms, plan = profile(name, rpm * factor, full - park, args.freq_hz, kmh == 0)
+            except ValueError as e:
+                parser.error(str(e))
+            source.append('    {   // %d km/h, %.1f rpm' % (kmh, rpm * factor))
+            source.append('        .fade = {')
+            for scale, cycle_num, steps in plan:
+                source.append('            { .scale = %d, .cycle_num = %d, .steps = %d },' % (scale, cycle_num, steps))
+            source.append('        },')
+            source.append('        .periods = %d,' % periods)
+            source.append('        .half_period_ms = %d,' % half_period_ms)
+            source.append('    },')
+        source.append('};')
+        source.append('')
+    for name, rpm in speeds:
+        header.append('#define servo_profile_%-5s (servo_speed_%s[0])' % (name, name))
+
+    header.append('')
+    header.append('// INT dwell in each band, percent of the dwell at standstill')
+    header.append('extern const uint8_t servo_speed_dwell_pct[SERVO_SPEED_BANDS];')
+    header.append('// pulses in the speed window from which each band applies')
+    header.append('extern const uint16_t servo_speed_pulses[SERVO_SPEED_BANDS];')
+    source.append('const uint8_t servo_speed_dwell_pct[SERVO_SPEED_BANDS] = {')
+    source += ['    %3d,    // %d km/h' % (int(round(100 / factor)), kmh) for kmh, factor, pulses in bands]
+    source.append('};')
+    source.append('')
+    source.append('const uint16_t servo_speed_pulses[SERVO_SPEED_BANDS] = {')
+    source += ['    %5d,    // %d km/h' % (pulses, kmh) for kmh, factor, pulses in bands]
+    source.append('};')
+    source.append('')
+
+    header += ['', '#endif', '']
+
+    write_if_changed(os.path.join(args.out_dir, 'servo_table.h'), '\n'.join(header))
+    write_if_changed(os.path.join(args.out_dir, 'servo_table.c'), '\n'.join(source))
+
+
+def write_if_changed(path, text):
+    """Only touch the output when it changes so dependent objects are not rebuilt."""
+    try:
+        with open(path) as f:
+            if f.read() == text:
+                return
+    except IOError:
+        pass
+    with open(path, 'w') as f:
+        f.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,199 @@
+#include "health.h"
+#include <stdio.h>
+#include <inttypes.h>
+#include "esp_timer.h"
+#include "esp_task_wdt.h"
+#include "event_log.h"
+
+#define HEALTH_TASK_PRIORITY    (configMAX_PRIORITIES - 3)  // below the motor protection task
+#define HEALTH_CHECK_MS         (100)   // heartbeat deadline check period
+#define HEALTH_STACK_CHECK      (10)    // check stack headroom every 10 deadline checks
+#define HEALTH_STACK_LOW_BYTES  (256)   // warn when a task has less stack left than this
+#define HEALTH_TASK_STACK       (2048)
+#define HEALTH_TLS_INDEX        (configNUM_THREAD_LOCAL_STORAGE_POINTERS - 1)  // last slot, slot 0 is taken by pthread keys
+
+_Static_assert(HEALTH_TLS_INDEX != 0, "set CONFIG_FREERTOS_THREAD_LOCAL_STORAGE_POINTERS to 2 or more, slot 0 belongs to pthread");
+
+typedef struct {
+    const health_spec_t *spec;
+    TaskHandle_t handle;
+    volatile bool active;               // task is running and watched
+    bool subscribed;                    // task has added itself to the task watchdog
+    bool stack_warned;                  // low stack already reported
+    volatile uint32_t last_beat_us;     // time of the last heartbeat (wraps after 71 min)
+    uint32_t last_period_us;            // time between the last two heartbeats
+    uint32_t max_period_us;             // longest time between heartbeats
+    uint32_t max_cost_us;               // longest time spent in health_beat()
+    uint32_t stack_free;                // lowest stack headroom seen (bytes)
+    uint32_t missed;                    // missed deadlines
+    uint32_t restarts;                  // times the task was restarted
+    volatile bool reclaimed;            // the last instance's static memory has been released
+} health_slot_t;
+
+static health_slot_t slots[HEALTH_COUNT];
+static void (*safe_state_cb)(void);     // parks the servo before a restart
+#if CONFIG_WIPER_STATIC_ALLOC
+static StackType_t health_stack[HEALTH_TASK_STACK];    // StackType_t is a byte on ESP-IDF
+static StaticTask_t health_tcb;
+
+// called by FreeRTOS when a deleted task's control block is cleaned up
+static void health_reclaimed(int index, void *value)
+{
+    ((health_slot_t *)value)->reclaimed = true;
+}
+#endif
+
+void health_start(health_task_t id, const health_spec_t *spec)
+{
+    health_slot_t *slot = &slots[id];
+
+    slot->spec = spec;
+    slot->subscribed = false;
+    slot->last_beat_us = (uint32_t)esp_timer_get_time();
+    slot->active = true;
+#if CONFIG_WIPER_STATIC_ALLOC
+    // a task that deleted itself, or was running on the other core when it was deleted, is only
+    // cleaned up later by the idle task, and its stack and control block can't be reused before that
+    while (slot->handle != NULL && !slot->reclaimed){
+        vTaskDelay(1);
+    }
+    slot->reclaimed = false;
+    slot->handle = xTaskCreateStatic(spec->entry, spec->name, spec->stack, NULL, spec->priority, spec->stack_buf, spec->tcb);
+    vTaskSetThreadLocalStoragePointerAndDelCallback(slot->handle, HEALTH_TLS_INDEX, slot, health_reclaimed);
+#else
+    xTaskCreate(spec->entry, spec->name, spec->stack, NULL, spec->priority, &slot->handle);
+#endif
+}
+
+void health_beat(health_task_t id)
+{
+    health_slot_t *slot = &slots[id];
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    // first beat of a (re)started task subscribes it to the task watchdog
+    if (!slot->subscribed){
+        esp_task_wdt_add(NULL);
+        slot->subscribed = true;
+    }
+    else{
+        slot->last_period_us = now - slot->last_beat_us;
+        if (slot->last_period_us > slot->max_period_us){
+            slot->max_period_us = slot->last_period_us;
+        }
+    }
+    esp_task_wdt_reset();
+    slot->last_beat_us = now;
+
+    uint32_t cost = (uint32_t)esp_timer_get_time() - now;
+    if (cost > slot->max_cost_us){
+        slot->max_cost_us = cost;
+    }
+}
+
+void health_stop(health_task_t id)
+{
+    health_slot_t *slot = &slots[id];
+
+    slot->active = false;
+    if (slot->subscribed){
+        esp_task_wdt_delete(NULL);
+        slot->subscribed = false;
+    }
+}
+
+bool health_running(health_task_t id)
+{
+    return slots[id].active;
+}
+
+// park the servo, then replace a task that stopped beating with a fresh copy
+static void health_restart(health_task_t id)
+{
+    health_slot_t *slot = &slots[id];
+
+    printf("Health: %s missed its %d ms deadline, restarting it.\n", slot->spec->name, slot->spec->deadline_ms);
+    event_log_add(EVENT_TASK_RESTART, id);
+    safe_state_cb();
+
+    if (slot->subscribed){
+        esp_task_wdt_delete(slot->handle);
+    }
+    vTaskDelete(slot->handle);
+    slot->restarts++;
+    health_start(id, slot->spec);
+}
+
+// Task to check every watched task against its heartbeat deadline and stack headroom
+static void health_task(void *pvParameter)
+{
+    TickType_t wake = xTaskGetTickCount();
+    int checks = 0;
+
+    while (1){
+        xTaskDelayUntil(&wake, pdMS_TO_TICKS(HEALTH_CHECK_MS));
+        checks++;
+
+        for (int id = 0; id < HEALTH_COUNT; id++){
+            health_slot_t *slot = &slots[id];
+            if (!slot->active){
+                continue;
+            }
+
+            if ((uint32_t)esp_timer_get_time() - slot->last_beat_us > (uint32_t)slot->spec->deadline_ms * 1000){
+                slot->missed++;
+                health_restart(id);
+                continue;
+            }
+
+            // the high-water mark scans the stack, so only look at it now and then
+            if (checks % HEALTH_STACK_CHECK == 0){
+                slot->stack_free = uxTaskGetStackHighWaterMark(slot->handle);
+                if (slot->stack_free < HEALTH_STACK_LOW_BYTES && !slot->stack_warned){
+                    printf("Health: %s has %" PRIu32 " bytes of stack left.\n", slot->spec->name, slot->stack_free);
+                    event_log_add(EVENT_STACK_LOW, id);
+                    slot->stack_warned = true;
+                }
+            }
+        }
+    }
+}
+
+void health_init(void (*safe_state)(void))
+{
+    safe_state_cb = safe_state;
+#if CONFIG_WIPER_STATIC_ALLOC
+    xTaskCreateStatic(health_task, "Health_Task", HEALTH_TASK_STACK, NULL, HEALTH_TASK_PRIORITY, health_stack, &health_tcb);
+#else
+    xTaskCreate(health_task, "Health_Task", HEALTH_TASK_STACK, NULL, HEALTH_TASK_PRIORITY, NULL);
+#endif
+}
+
+bool health_get_stats(health_task_t id, health_stats_t *stats)
+{
+    health_slot_t *slot = &slots[id];
+
+    if (slot->spec == NULL){
+        return false;
+    }
+    stats->name = slot->spec->name;
+    stats->period_ms = slot->last_period_us / 1000;
+    stats->max_period_ms = slot->max_period_us / 1000;
+    stats->stack_free = slot->stack_free;
+    stats->missed = slot->missed;
+    stats->restarts = slot->restarts;
+    return true;
+}
+
+void health_print(void)
+{
+    for (int id = 0; id < HEALTH_COUNT; id++){
+        health_slot_t *slot = &slots[id];
+        if (slot->spec == NULL){
+            continue;
+        }
+        printf("%-12s period %" PRIu32 " ms (max %" PRIu32 "), stack free %" PRIu32 " B, beat %" PRIu32 " us, "
+               "missed %" PRIu32 ", restarts %" PRIu32 "\n",
+               slot->spec->name, slot->last_period_us / 1000, slot->max_period_us / 1000, slot->stack_free,
+               slot->max_cost_us, slot->missed, slot->restarts);
+    }
+}
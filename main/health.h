@@ -0,0 +1,64 @@
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include <freertos/task.h>
+#include "sdkconfig.h"
+
+// long-lived tasks watched by the health supervisor
+typedef enum {
+    HEALTH_CONTROL = 0,         // ignition state machine and wiper knob readings
+    HEALTH_DISPLAY,             // LCD writes
+    HEALTH_WIPER,               // servo sweeps
+#if CONFIG_WIPER_CAN_BUS
+    HEALTH_CAN,                 // TWAI vehicle bus
+#endif
+    HEALTH_COUNT
+} health_task_t;
+
+// how to (re)create a watched task
+typedef struct {
+    const char *name;
+    TaskFunction_t entry;
+    uint32_t stack;             // bytes
+    UBaseType_t priority;
+    int deadline_ms;            // longest allowed time between heartbeats
+#if CONFIG_WIPER_STATIC_ALLOC
+    StackType_t *stack_buf;     // stack bytes of static memory, reused on every restart
+    StaticTask_t *tcb;
+#endif
+} health_spec_t;
+
+// per-task figures for reporting
+typedef struct {
+    const char *name;
+    uint32_t period_ms;         // time between the last two heartbeats
+    uint32_t max_period_ms;     // longest time between heartbeats
+    uint32_t stack_free;        // lowest stack headroom seen (bytes)
+    uint32_t missed;            // missed deadlines
+    uint32_t restarts;          // times the task was restarted
+} health_stats_t;
+
+// start the supervisor, safe_state is called before a stuck task is restarted
+void health_init(void (*safe_state)(void));
+
+// create a task and watch its heartbeats (spec must stay valid for restarts)
+void health_start(health_task_t id, const health_spec_t *spec);
+
+// heartbeat from the watched task itself: feeds the task watchdog, constant time
+void health_beat(health_task_t id);
+
+// called by a watched task just before it deletes itself
+void health_stop(health_task_t id);
+
+// true while a task is running under the supervisor
+bool health_running(health_task_t id);
+
+// copy one task's figures, false if it was never started
+bool health_get_stats(health_task_t id, health_stats_t *stats);
+
+// print loop periods, stack headroom, missed deadlines and restarts per task
+void health_print(void);
+
+#endif
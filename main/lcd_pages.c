@@ -0,0 +1,265 @@
+#include "lcd_pages.h"
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+
+#define LCD_DDRAM_COLS          (40)    // DDRAM cells per line, the hardware shift wraps around them
+#define LCD_MARQUEE_GAP         (3)     // blanks between the end of a message and its next pass
+#define LCD_MARQUEE_HOLD        (4)     // frames the start of a message is held before it moves
+#define LCD_MARQUEE_FRAME_MS    (350)   // one column per frame, bounds the frame rate to under 3 Hz
+#define LCD_MAX_RUNS            (LCD_LINES * LCD_DDRAM_COLS / 2)   // changed cells in one update, every other cell at worst
+
+static char pages[LCD_PAGE_COUNT][LCD_LINES][LCD_TEXT_MAX + 1];    // back buffers written by the other tasks
+static lcd_page_t shown_page = LCD_PAGE_STATUS;
+static portMUX_TYPE pages_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// display task only
+static char glass[LCD_LINES][LCD_DDRAM_COLS];  // front buffer: DDRAM contents
+static int glass_shift = -1;                    // hardware display shift, -1 if unknown
+static char shown_text[LCD_LINES][LCD_TEXT_MAX + 1];   // text the marquee frame count belongs to
+static lcd_page_t frame_page = LCD_PAGE_COUNT;
+static int frame;                               // marquee frames since the text was shown
+static int64_t frame_us;                        // time of the last frame
+static int bus_bytes;                           // bytes sent to each panel in the current flush
+static lcd_pages_stats_t stats;
+static const hd44780_t *const *panels;          // panels the current flush writes to
+static int panel_count;
+static hd44780_write_t writes[LCD_MAX_RUNS * LCD_MAX_PANELS];  // runs of changed cells for every panel
+static int write_count;
+static char run_text[LCD_LINES * LCD_DDRAM_COLS + LCD_MAX_RUNS];   // their characters, each run terminated
+static int run_used;
+#if CONFIG_WIPER_LCD_TIMED
+static hd44780_timed_t *timed;                  // transport for the runs, NULL for the blocking driver
+#endif
+
+void lcd_pages_set(lcd_page_t page, int line, const char *text)
+{
+    char padded[LCD_TEXT_MAX + 1];
+
+    snprintf(padded, sizeof(padded), "%-16s", text);   // short text fills the line, long text scrolls
+    portENTER_CRITICAL(&pages_lock);
+    strcpy(pages[page][line], padded);
+    portEXIT_CRITICAL(&pages_lock);
+}
+
+void lcd_pages_show(lcd_page_t page)
+{
+    portENTER_CRITICAL(&pages_lock);
+    shown_page = page;
+    portEXIT_CRITICAL(&pages_lock);
+}
+
+lcd_page_t lcd_pages_shown(void)
+{
+    return shown_page;
+}
+
+void lcd_pages_invalidate(void)
+{
+    glass_shift = -1;           // the next flush clears the LCD to a known state
+}
+
+// queue the cells of a line that differ from the glass as runs, one write per run and panel
+static void lcd_line(int line, const char *cells, int count)
+{
+    int col = 0;
+    int end;
+    int p;
+
+    while (col < count){
+        if (glass[line][col] == cells[col]){
+            col++;
+            continue;
+        }
+        for(end = col; end < count && glass[line][end] != cells[end]; end++){
+            glass[line][end] = cells[end];
+        }
+        memcpy(&run_text[run_used], &cells[col], end - col);
+        run_text[run_used + end - col] = '\0';
+        for(p = 0; p < panel_count; p++){
+            writes[write_count++] = (hd44780_write_t){
+                .lcd = panels[p], .col = col, .line = line, .text = &run_text[run_used],
+            };
+        }
+        run_used += end - col + 1;
+        bus_bytes += 1 + end - col;     // address command and characters
+        col = end;
+    }
+}
+
+// send the queued runs to every panel
+static void lcd_write_runs(void)
+{
+#if CONFIG_WIPER_LCD_TIMED
+    if (timed != NULL){
+        hd44780_timed_write(timed, writes, write_count);
+        return;
+    }
+#endif
+    hd44780_write_batch(writes, write_count);
+}
+
+// move the hardware shift to shift columns on every panel, taking the short way round
+static void lcd_shift(int shift)
+{
+    int left = (shift - glass_shift + LCD_DDRAM_COLS) % LCD_DDRAM_COLS;
+    int p;
+
+    for(; left > 0 && left <= LCD_DDRAM_COLS / 2; left--){
+        for(p = 0; p < panel_count; p++){
+            hd44780_scroll_left(panels[p]);
+        }
+        bus_bytes++;
+    }
+    for(; left > LCD_DDRAM_COLS / 2 && left < LCD_DDRAM_COLS; left++){
+        for(p = 0; p < panel_count; p++){
+            hd44780_scroll_right(panels[p]);
+        }
+        bus_bytes++;
+    }
+    glass_shift = shift;
+}
+
+// column a message shows at in this frame, holding at the start of every pass
+static int marquee_pos(int period)
+{
+    int pos = frame % (period + LCD_MARQUEE_HOLD) - LCD_MARQUEE_HOLD;
+    return pos < 0 ? 0 : pos;
+}
+
+int lcd_pages_flush(const hd44780_t *const *lcds, int count)
+{
+    char next[LCD_LINES][LCD_TEXT_MAX + 1];
+    char cells[LCD_DDRAM_COLS];
+    int len[LCD_LINES];
+    bool scrolling = false;
+    bool hardware = true;
+    lcd_page_t page;
+    int64_t start = esp_timer_get_time();
+    int line;
+    int col;
+    int p;
+
+    // snapshot the shown page in one go, so a swap or a two-line update never shows half done
+    portENTER_CRITICAL(&pages_lock);
+    page = shown_page;
+    memcpy(next, pages[page], sizeof(next));
+    portEXIT_CRITICAL(&pages_lock);
+
+    panels = lcds;
+    panel_count = count;
+    write_count = 0;
+    run_used = 0;
+    bus_bytes = 0;
+    if (glass_shift < 0){
+        for(p = 0; p < panel_count; p++){
+            hd44780_clear(panels[p]);       // also undoes any hardware shift
+        }
+        bus_bytes++;
+        memset(glass, ' ', sizeof(glass));
+        glass_shift = 0;
+    }
+
+    // new text starts its marquee from the beginning, otherwise frames advance at a fixed rate
+    if (page != frame_page || memcmp(next, shown_text, sizeof(next)) != 0){
+        memcpy(shown_text, next, sizeof(next));
+        frame_page = page;
+        frame = 0;
+        frame_us = start;
+    }
+    else if (start - frame_us >= LCD_MARQUEE_FRAME_MS * 1000){
+        frame++;
+        frame_us += LCD_MARQUEE_FRAME_MS * 1000;
+        if (start - frame_us >= LCD_MARQUEE_FRAME_MS * 1000){
+            frame_us = start;   // the display task was held up, don't catch up in a burst
+        }
+    }
+
+    // the controller shifts both lines together around 40 DDRAM cells, so scroll in hardware
+    // only if every line that isn't blank is a message that fits that loop with its gap
+    for(line = 0; line < LCD_LINES; line++){
+        if (next[line][0] == '\0'){
+            strcpy(next[line], "                ");   // never set
+        }
+        len[line] = strlen(next[line]);
+        if (len[line] > LCD_COLS){
+            scrolling = true;
+            if (len[line] > LCD_DDRAM_COLS - LCD_MARQUEE_GAP){
+                hardware = false;
+            }
+        }
+        else if ((int)strspn(next[line], " ") != len[line]){
+            hardware = false;
+        }
+    }
+
+    if (scrolling && hardware){
+        // whole messages in DDRAM (sent once per text), then one shift command per frame
+        for(line = 0; line < LCD_LINES; line++){
+            for(col = 0; col < LCD_DDRAM_COLS; col++){
+                cells[col] = col < len[line] && len[line] > LCD_COLS ? next[line][col] : ' ';
+            }
+            lcd_line(line, cells, LCD_DDRAM_COLS);
+        }
+        lcd_write_runs();
+        lcd_shift(marquee_pos(LCD_DDRAM_COLS));
+    }
+    else{
+        // software window: unshifted display, each line rewritten where its 16 visible cells differ
+        if (glass_shift != 0){
+            lcd_shift(0);
+        }
+        for(line = 0; line < LCD_LINES; line++){
+            int period = len[line] + LCD_MARQUEE_GAP;
+            int pos = len[line] > LCD_COLS ? marquee_pos(period) : 0;
+            for(col = 0; col < LCD_COLS; col++){
+                int i = (pos + col) % period;
+                cells[col] = i < len[line] ? next[line][i] : ' ';
+            }
+            lcd_line(line, cells, LCD_COLS);
+        }
+        lcd_write_runs();
+    }
+
+    // bus cost of the frames that moved or changed something
+    if (bus_bytes > 0){
+        uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+        if (scrolling && hardware){
+            stats.hw_frames++;
+        }
+        else{
+            stats.sw_frames++;
+        }
+        stats.bytes += bus_bytes;
+        if ((uint32_t)bus_bytes > stats.max_frame_bytes){
+            stats.max_frame_bytes = bus_bytes;
+        }
+        if (us > stats.max_frame_us){
+            stats.max_frame_us = us;
+        }
+    }
+    return bus_bytes;
+}
+
+#if CONFIG_WIPER_LCD_TIMED
+void lcd_pages_use_timed(hd44780_timed_t *dev)
+{
+    timed = dev;
+}
+#endif
+
+void lcd_pages_get_stats(lcd_pages_stats_t *out)
+{
+    *out = stats;
+}
+
+void lcd_pages_print_stats(void)
+{
+    uint32_t frames = stats.hw_frames + stats.sw_frames;
+
+    printf("LCD: %lu updates (%lu hardware shift, %lu software), %lu bytes/update avg, %lu max, %lu us max\n",
+           (unsigned long)frames, (unsigned long)stats.hw_frames, (unsigned long)stats.sw_frames,
+           (unsigned long)(frames ? stats.bytes / frames : 0), (unsigned long)stats.max_frame_bytes,
+           (unsigned long)stats.max_frame_us);
+}
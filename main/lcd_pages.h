@@ -0,0 +1,60 @@
+#ifndef LCD_PAGES_H
+#define LCD_PAGES_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "../components/hd44780/hd44780.h"
+#if CONFIG_WIPER_LCD_TIMED
+#include "../components/hd44780/hd44780_timed.h"
+#endif
+
+#define LCD_COLS        (16)
+#define LCD_LINES       (2)
+#define LCD_TEXT_MAX    (128)   // longest line text, anything over LCD_COLS scrolls
+#define LCD_MAX_PANELS  (2)     // panels showing the same page, the driver's and the instructor's
+
+// logical 16x2 screens, any task can write any page, one is shown at a time
+typedef enum {
+    LCD_PAGE_STATUS = 0,        // wiper mode and INT delay (blank while the engine is off)
+    LCD_PAGE_WARNINGS,          // why the last ignition attempt was inhibited
+    LCD_PAGE_DIAG,              // motor fault and task restarts
+    LCD_PAGE_COUNT
+} lcd_page_t;
+
+// bus cost of the LCD updates (a marquee frame, a page swap or a changed line)
+typedef struct {
+    uint32_t hw_frames;         // updates scrolled with the controller's display shift
+    uint32_t sw_frames;         // updates rewritten through a software window
+    uint32_t bytes;             // commands and characters sent to each panel in all updates
+    uint32_t max_frame_bytes;
+    uint32_t max_frame_us;
+} lcd_pages_stats_t;
+
+// set one line of a page: short text is padded to the full width, longer text scrolls as a
+// marquee, with the controller's display shift when the page allows it
+void lcd_pages_set(lcd_page_t page, int line, const char *text);
+
+// switch the page that is shown, takes effect atomically on the next flush
+void lcd_pages_show(lcd_page_t page);
+
+// page currently selected
+lcd_page_t lcd_pages_shown(void);
+
+// forget what is on the glass so the next flush rewrites every cell (after a display task restart)
+void lcd_pages_invalidate(void);
+
+// bring the LCDs up to date with the shown page and advance its marquees, writing only cells
+// that differ, returns the number of bytes sent to each LCD (display task only). Every panel
+// shows the same thing, so they must be initialised and invalidated together
+int lcd_pages_flush(const hd44780_t *const *lcds, int count);
+
+#if CONFIG_WIPER_LCD_TIMED
+// send the changed cells through a timed transport for the panels' bus (display task only)
+void lcd_pages_use_timed(hd44780_timed_t *dev);
+#endif
+
+// copy or print the update counts and bus cost
+void lcd_pages_get_stats(lcd_pages_stats_t *out);
+void lcd_pages_print_stats(void);
+
+#endif
@@ -0,0 +1,192 @@
+#include "led_fx.h"
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/ledc.h"
+#include "esp_attr.h"
+#include "sdkconfig.h"
+
+#define LED_MODE            LEDC_LOW_SPEED_MODE     // timers 0 and 1 and their channels are the servo and buzzer
+#define LED_DUTY_RES        LEDC_TIMER_14_BIT       // wide enough for the 5 Hz blink divider
+#define LED_DUTY_FULL       ((1 << LED_DUTY_RES) - 1)
+#define LED_DUTY_DIM        (LED_DUTY_FULL / 50)    // bottom of a breath, the LED never goes dark
+#define LED_HZ              (1000)                  // PWM for the steady and faded levels
+#define LED_BLINK_HZ        (5)                     // the blink is the PWM itself
+#define LED_FADE_MS         (300)
+#define LED_BREATH_MS       (1500)                  // each way
+#define LED_QUEUE_LEN       (8)
+#define LED_TASK_STACK      (2048)
+#define LED_TASK_PRIORITY   (2)                     // above the control task, the work is a few register writes
+
+typedef struct {
+    uint8_t led;                // led_fx_led_t
+    uint8_t effect;             // led_fx_effect_t, or LED_FX_EFFECT_COUNT for a fade end
+} led_fx_msg_t;
+
+typedef struct {
+    ledc_timer_t timer;
+    ledc_channel_t channel;
+    led_fx_effect_t effect;     // running effect, only touched by the effect task
+    int target;                 // duty the running fade ends at
+    int hz;                     // timer frequency
+} led_fx_state_t;
+
+static led_fx_state_t leds[LED_FX_COUNT] = {
+    [LED_FX_READY]   = { .timer = LEDC_TIMER_2, .channel = LEDC_CHANNEL_2 },
+    [LED_FX_SUCCESS] = { .timer = LEDC_TIMER_3, .channel = LEDC_CHANNEL_3 },
+};
+static volatile led_fx_effect_t requested[LED_FX_COUNT];    // last effect asked for, filters repeats
+static QueueHandle_t led_queue;
+#if CONFIG_WIPER_STATIC_ALLOC
+static uint8_t led_queue_storage[LED_QUEUE_LEN * sizeof(led_fx_msg_t)];
+static StaticQueue_t led_queue_buf;
+static StackType_t led_stack[LED_TASK_STACK];
+static StaticTask_t led_tcb;
+#endif
+
+// fade end interrupt: hand the LED to the effect task, which turns a breath around
+static bool IRAM_ATTR led_fade_done(const ledc_cb_param_t *param, void *user_arg)
+{
+    BaseType_t woken = pdFALSE;
+    led_fx_msg_t msg = { .led = (uint8_t)(uintptr_t)user_arg, .effect = LED_FX_EFFECT_COUNT };
+
+    if (param->event == LEDC_FADE_END_EVT){
+        xQueueSendFromISR(led_queue, &msg, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+static void led_freq(led_fx_state_t *led, int hz)
+{
+    if (led->hz != hz){
+        ledc_set_freq(LED_MODE, led->timer, hz);
+        led->hz = hz;
+    }
+}
+
+static void led_duty(led_fx_state_t *led, int duty)
+{
+    led->target = duty;
+    ledc_set_duty(LED_MODE, led->channel, duty);
+    ledc_update_duty(LED_MODE, led->channel);
+}
+
+static void led_fade(led_fx_state_t *led, int duty, int ms)
+{
+    led->target = duty;
+    ledc_set_fade_with_time(LED_MODE, led->channel, duty, ms);
+    ledc_fade_start(LED_MODE, led->channel, LEDC_FADE_NO_WAIT);
+}
+
+static void led_start(led_fx_state_t *led, led_fx_effect_t effect)
+{
+    ledc_fade_stop(LED_MODE, led->channel);
+    led->effect = effect;
+    led_freq(led, effect == LED_FX_BLINK ? LED_BLINK_HZ : LED_HZ);
+
+    switch (effect){
+    case LED_FX_ON:
+        led_duty(led, LED_DUTY_FULL);
+        break;
+    case LED_FX_FADE_OFF:
+        led_fade(led, 0, LED_FADE_MS);
+        break;
+    case LED_FX_FADE_ON:
+        led_fade(led, LED_DUTY_FULL, LED_FADE_MS);
+        break;
+    case LED_FX_BREATHE:
+        led_fade(led, LED_DUTY_FULL, LED_BREATH_MS);
+        break;
+    case LED_FX_BLINK:
+        led_duty(led, (LED_DUTY_FULL + 1) / 2);     // 100 ms on, 100 ms off
+        break;
+    default:
+        led_duty(led, 0);
+        break;
+    }
+}
+
+// only task that touches the LED channels: effect changes and breath turnarounds
+static void led_task(void *pvParameter)
+{
+    led_fx_msg_t msg;
+
+    while (1){
+        xQueueReceive(led_queue, &msg, portMAX_DELAY);
+        led_fx_state_t *led = &leds[msg.led];
+
+        if (msg.effect != LED_FX_EFFECT_COUNT){
+            led_start(led, msg.effect);
+        }
+        // a fade end that is still current (not from a fade an effect change stopped)
+        else if (led->effect == LED_FX_BREATHE && ledc_get_duty(LED_MODE, led->channel) == (uint32_t)led->target){
+            led_fade(led, led->target == LED_DUTY_FULL ? LED_DUTY_DIM : LED_DUTY_FULL, LED_BREATH_MS);
+        }
+    }
+}
+
+esp_err_t led_fx_init(gpio_num_t ready_pin, gpio_num_t success_pin)
+{
+    const gpio_num_t pins[LED_FX_COUNT] = { [LED_FX_READY] = ready_pin, [LED_FX_SUCCESS] = success_pin };
+    esp_err_t err = ESP_OK;
+
+#if CONFIG_WIPER_STATIC_ALLOC
+    led_queue = xQueueCreateStatic(LED_QUEUE_LEN, sizeof(led_fx_msg_t), led_queue_storage, &led_queue_buf);
+#else
+    led_queue = xQueueCreate(LED_QUEUE_LEN, sizeof(led_fx_msg_t));
+#endif
+    if (led_queue == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < LED_FX_COUNT && err == ESP_OK; i++){
+        ledc_timer_config_t timer = {
+            .speed_mode       = LED_MODE,
+            .duty_resolution  = LED_DUTY_RES,
+            .timer_num        = leds[i].timer,
+            .freq_hz          = LED_HZ,
+            .clk_cfg          = LEDC_AUTO_CLK       // must match the servo timer's clock in low speed mode
+        };
+        ledc_channel_config_t channel = {
+            .speed_mode     = LED_MODE,
+            .channel        = leds[i].channel,
+            .timer_sel      = leds[i].timer,
+            .intr_type      = LEDC_INTR_DISABLE,
+            .gpio_num       = pins[i],
+            .duty           = 0,
+            .hpoint         = 0
+        };
+        ledc_cbs_t callbacks = {
+            .fade_cb = led_fade_done,
+        };
+
+        leds[i].hz = LED_HZ;
+        err = ledc_timer_config(&timer);
+        if (err == ESP_OK){
+            err = ledc_channel_config(&channel);
+        }
+        if (err == ESP_OK){
+            err = ledc_cb_register(LED_MODE, leds[i].channel, &callbacks, (void *)(uintptr_t)i);
+        }
+    }
+    if (err != ESP_OK){
+        return err;
+    }
+
+#if CONFIG_WIPER_STATIC_ALLOC
+    xTaskCreateStatic(led_task, "LED_Task", LED_TASK_STACK, NULL, LED_TASK_PRIORITY, led_stack, &led_tcb);
+#else
+    xTaskCreate(led_task, "LED_Task", LED_TASK_STACK, NULL, LED_TASK_PRIORITY, NULL);
+#endif
+    return ESP_OK;
+}
+
+void led_fx_set(led_fx_led_t led, led_fx_effect_t effect)
+{
+    led_fx_msg_t msg = { .led = led, .effect = effect };
+
+    if (requested[led] != effect && xQueueSend(led_queue, &msg, 0) == pdTRUE){
+        requested[led] = effect;
+    }
+}
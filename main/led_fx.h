@@ -0,0 +1,34 @@
+#ifndef LED_FX_H
+#define LED_FX_H
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+// Indicator LED effects on LEDC timers 2 and 3 (one per LED). Fades run on the LEDC fade
+// engine, which steps the brightness once per PWM period. A small task is only woken by the
+// fade end interrupt to turn a breath around (every 1.5 s). A blink is the LED timer slowed
+// down to 5 Hz, so it takes no CPU at all.
+
+typedef enum {
+    LED_FX_READY = 0,           // green, ignition enabled
+    LED_FX_SUCCESS,             // red, engine running
+    LED_FX_COUNT
+} led_fx_led_t;
+
+typedef enum {
+    LED_FX_OFF = 0,
+    LED_FX_ON,
+    LED_FX_FADE_OFF,            // dim out over 300 ms and stay off
+    LED_FX_FADE_ON,             // light up over 300 ms and stay on
+    LED_FX_BREATHE,             // slow pulse, 3 s per breath
+    LED_FX_BLINK,               // fast blink, 5 Hz
+    LED_FX_EFFECT_COUNT
+} led_fx_effect_t;
+
+// set up the LEDC timers and channels (after ledc_fade_func_install()) and start the effect task
+esp_err_t led_fx_init(gpio_num_t ready_pin, gpio_num_t success_pin);
+
+// switch an LED to an effect (any task), returns at once, nothing happens if it already runs it
+void led_fx_set(led_fx_led_t led, led_fx_effect_t effect);
+
+#endif
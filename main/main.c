@@ -1,13 +1,33 @@
 #include "freertos/FreeRTOS.h"
 #include <freertos/task.h>
 #include <sys/time.h>
-#include "../managed_components/esp-idf-lib__hd44780/hd44780.h"
+#include "../components/hd44780/hd44780.h"
 #include "../managed_components/esp-idf-lib__esp_idf_lib_helpers/esp_idf_lib_helpers.h"
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 #include "driver/gpio.h"
-#include "esp_adc/adc_oneshot.h"
 #include "driver/ledc.h"
+#include "esp_attr.h"
+#include "analog_in.h"
+#include "servo_feedback.h"
+#include "wiper_protect.h"
+#include "health.h"
+#include "can_bus.h"
+#include "telemetry.h"
+#include "servo_table.h"
+#include "vehicle.h"
+#include "wiper_engine.h"
+#include "replay.h"
+#include "lcd_pages.h"
+#include "event_bus.h"
+#include "event_log.h"
+#include "boot_time.h"
+#include "buzzer.h"
+#include "led_fx.h"
+#include "warm_start.h"
+#include "seat_watch.h"
+#include "wheel_speed.h"
 
 // ignition subsystem
 #define PSEAT_PIN       GPIO_NUM_7      // passenger seat button pin 7
@@ -19,407 +39,701 @@
 #define SUCCESS_LED     GPIO_NUM_19     // success LED pin 19
 #define ALARM_PIN       GPIO_NUM_18     // alarm pin 18
 
-// wiper subsystem
-#define WIPER_CONTROL   ADC_CHANNEL_8   // wiper control (potentiometer) ADC1 channel 8
-#define INT_WIPER_CONTROL      ADC_CHANNEL_9   // wiper intermittence control (potentiometer) ADC1 channel 9
-#define ADC_ATTEN       ADC_ATTEN_DB_12 // set ADC attenuation
-#define BITWIDTH        ADC_BITWIDTH_12 // set ADC bitwidth
-#define WIPER_POTENT_OFF    (500)       // adcmV level for wipers off
-#define WIPER_POTENT_LOW    (1570)      // adcmV level for wipers low
-#define WIPER_POTENT_HI     (2650)      // adcmV level for wipers high
-#define WIPER_INT_SHORT     (910)       // adcmV level for intermittence short
-#define WIPER_INT_LONG      (1960)      // adcmV level for intermittence long
-
+// wiper subsystem (ADC channels are in analog_in.h, knob thresholds in vehicle.h)
 #define LEDC_TIMER      LEDC_TIMER_0
 #define LEDC_MODE       LEDC_LOW_SPEED_MODE
 #define LEDC_OUTPUT_IO      (16)        // pwm signal to motor pin 16
 #define LEDC_CHANNEL    LEDC_CHANNEL_0
-#define LEDC_DUTY_RES   LEDC_TIMER_13_BIT // set duty resolution to 13 bits
+#define LEDC_DUTY_RES   SERVO_DUTY_RES  // duty resolution (widest the clock allows, 14 bits at 50 Hz)
 
 //Set the PWM signal frequency required by servo motor
-#define LEDC_FREQUENCY      (50) // Frequency in Hertz. 
-
-//Calculate the values for the minimum (0.75ms) and center (1.5ms) servo pulse widths
-#define LEDC_DUTY_MIN       (210) // Set duty to ~3.75%.
-#define LEDC_DUTY_CENTER    (610) // Set duty to ~7.5%.
-
-//Calculate delays for servo motor for-loops
-#define delay_low           (1500.0/(LEDC_DUTY_CENTER - LEDC_DUTY_MIN)) // delay for LOW/INT settings, 1500ms is half-period (90 degrees)
-#define delay_high          (600.0/(LEDC_DUTY_CENTER - LEDC_DUTY_MIN)) //delay for HIGH setting, 600ms is half-period (90 degrees)
-
-bool dseat = false;     //Detects when the driver is seated 
-bool pseat = false;     //Detects when the passenger is seated
-bool dbelt = false;     //Detects when the driver seatbelt is on
-bool pbelt = false;     //Detects when the passenger seatbelt is on
-bool ignition = false;  //Detects when the ignition is turned on
-int executed = 0;       //keeps track of print statements
-int ready_led = 0;      //keeps track of whether ready_led should be on or off
-int ignition_off = 0;   //keeps track of whether the ignition can be turned off
-int wiper = 0;          //keeps track of wiper setting
-int wiper_int = 0;      //keeps track of wiper intermittent setting
+#define LEDC_FREQUENCY      SERVO_FREQUENCY_HZ // Frequency in Hertz (50 by default)
+
+//Servo duty for the minimum (0 degrees) and center (90 degrees) positions, from servo_table.h
+#define LEDC_DUTY_MIN       SERVO_DUTY_PARK
+#define LEDC_DUTY_CENTER    SERVO_DUTY_FULL
+
+/* Sweep timing for the servo motor comes from the fade plans that gen_servo_table.py
+builds from menuconfig: servo_speed_low (LOW/INT) and servo_speed_high (HIGH), one plan per
+wheel speed band, band 0 (servo_profile_low and servo_profile_high) at standstill.
+The LEDC fade engine steps the duty every PWM period, so the wiper task only wakes
+at the end of each fade segment */
+#define WIPER_FADE_MARGIN_MS    (40)    // extra wait for a fade end interrupt (two PWM periods)
+#define WIPER_BEAT_MS           (1000)  // longest wiper wait without a heartbeat (task watchdog is 5 s)
+
+#define DISPLAY_ROTATE_MS       (3000)  // time each page is shown while status and diagnostics rotate
+#define CONTROL_IDLE_MS         (100)   // control pass period when no events arrive
+#define CONTROL_STACK           (3584)  // task stacks in bytes
+#define DISPLAY_STACK           (2048)
+#define WIPER_STACK             (2048)
+
+static vehicle_t vehicle;               //ignition state and wiper setting, updated by the control task
+static wiper_engine_t wiper_engine;     //sweep state of the wiper task
+static SemaphoreHandle_t wiper_wake;    //fade end or new wiper command, outlives wiper task restarts
+static volatile bool wiper_dwelling;    //wiper task in the INT dwell, woken by a new INT delay too
+static StaticSemaphore_t wiper_wake_buf;
+static bus_subscriber_t control_bus;    //input, knob, CAN command and fault events for the control task
+#if CONFIG_WIPER_INSTRUCTOR_LCD
+static hd44780_shared_bus_t lcd_bus;    //RS and data pins shared by both LCDs
+#endif
 
 // declare function for initializing ledc
-static void ledc_initialize(void);
+static void ledc_initialize(int duty);
+// declare the control task so the health supervisor can restart it
+static void control_task(void *pvParameter);
+
+// configuration structure for lcd
+static hd44780_t lcd =
+{
+    .write_cb = NULL,
+    .font = HD44780_FONT_5X8,
+    .lines = 2,
+    .pins = {
+        .rs = GPIO_NUM_39,
+        .e  = GPIO_NUM_37,
+        .d4 = GPIO_NUM_36,
+        .d5 = GPIO_NUM_35,
+        .d6 = GPIO_NUM_48,
+        .d7 = GPIO_NUM_47,
+        .bl = HD44780_NOT_USED
+    },
+#if CONFIG_WIPER_INSTRUCTOR_LCD
+    .shared = &lcd_bus,
+#endif
+};
+#if CONFIG_WIPER_LCD_TIMED
+static hd44780_timed_t lcd_timed = { .lcd = &lcd };     // timer driven writes on the LCD bus
+#endif
+#if CONFIG_WIPER_INSTRUCTOR_LCD
+// passenger side LCD on the same RS and data pins, with its own E
+static hd44780_t instructor_lcd =
+{
+    .write_cb = NULL,
+    .font = HD44780_FONT_5X8,
+    .lines = 2,
+    .pins = {
+        .rs = GPIO_NUM_39,
+        .e  = CONFIG_WIPER_INSTRUCTOR_LCD_E_GPIO,
+        .d4 = GPIO_NUM_36,
+        .d5 = GPIO_NUM_35,
+        .d6 = GPIO_NUM_48,
+        .d7 = GPIO_NUM_47,
+        .bl = HD44780_NOT_USED
+    },
+    .shared = &lcd_bus,
+};
+static const hd44780_t *const lcd_panels[] = { &lcd, &instructor_lcd };
+#else
+static const hd44780_t *const lcd_panels[] = { &lcd };
+#endif
+
+
+// cut the servo PWM immediately, called by the protection task on a motor fault
+static void wiper_cutoff(void)
+{
+    ledc_fade_stop(LEDC_MODE, LEDC_CHANNEL);
+    ledc_stop(LEDC_MODE, LEDC_CHANNEL, 0);
+}
+
+// health supervisor safe state: stop any sweep and hold the arm at 0 degrees (unless the motor was cut)
+static void wiper_park(void)
+{
+    ledc_fade_stop(LEDC_MODE, LEDC_CHANNEL);
+    if (wiper_protect_fault() == WIPER_FAULT_NONE){
+        ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, LEDC_DUTY_MIN);
+        ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
+        warm_start_save_servo(LEDC_DUTY_MIN, LEDC_DUTY_MIN, 0);
+    }
+}
+
+// fade end interrupt: wake the wiper task for its next fade segment
+static bool IRAM_ATTR wiper_fade_done(const ledc_cb_param_t *param, void *user_arg)
+{
+    BaseType_t woken = pdFALSE;
+    if (param->event == LEDC_FADE_END_EVT){
+        xSemaphoreGiveFromISR(wiper_wake, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+// wiper engine output on the LEDC fade engine, with the servo feedback and motor protection
+static void wiper_set_duty(void *ctx, int duty)
+{
+    ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, duty);
+    ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
+    warm_start_save_servo(duty, duty, 0);
+}
+
+// sleeps until the fade end interrupt, or until vehicle_to_wiper() wakes the task for a new command.
+// A segment at a few rpm lasts longer than the task watchdog, so the wait beats every WIPER_BEAT_MS
+static bool wiper_fade(void *ctx, int duty, const servo_fade_t *segment, int segment_ms)
+{
+    int wait_ms = segment_ms + WIPER_FADE_MARGIN_MS;
+    bool woken = false;
+
+    xSemaphoreTake(wiper_wake, 0);                  // drop a stale fade end or command
+    warm_start_save_servo(ledc_get_duty(LEDC_MODE, LEDC_CHANNEL), duty, segment_ms);
+    ledc_set_fade_step_and_start(LEDC_MODE, LEDC_CHANNEL, duty, segment->scale,
+                                 segment->cycle_num, LEDC_FADE_NO_WAIT);
+    while (!woken && wait_ms > 0){
+        int chunk_ms = wait_ms < WIPER_BEAT_MS ? wait_ms : WIPER_BEAT_MS;
+        woken = xSemaphoreTake(wiper_wake, pdMS_TO_TICKS(chunk_ms)) == pdTRUE;
+        health_beat(HEALTH_WIPER);
+        wait_ms -= chunk_ms;
+    }
+    return true;
+}
+
+// a finished fade has nothing to stop and reads back its target
+static int wiper_fade_stop(void *ctx)
+{
+    ledc_fade_stop(LEDC_MODE, LEDC_CHANNEL);
+    int duty = ledc_get_duty(LEDC_MODE, LEDC_CHANNEL);
+    warm_start_save_servo(duty, duty, 0);
+    return duty;
+}
+
+static bool wiper_wait_ms(void *ctx, int ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    health_beat(HEALTH_WIPER);
+    return true;
+}
+
+// sleeps until vehicle_to_wiper() wakes the task for a new command or INT delay
+static bool wiper_wait_change(void *ctx, int ms)
+{
+    xSemaphoreTake(wiper_wake, 0);                  // drop a stale fade end or command
+    wiper_dwelling = true;
+    xSemaphoreTake(wiper_wake, pdMS_TO_TICKS(ms));
+    wiper_dwelling = false;
+    health_beat(HEALTH_WIPER);
+    return true;
+}
+
+static int wiper_now_ms(void *ctx)
+{
+    return pdTICKS_TO_MS(xTaskGetTickCount());
+}
+
+static bool wiper_faulted(void *ctx)
+{
+    return wiper_protect_fault() != WIPER_FAULT_NONE;
+}
+
+static void wiper_clear_fault(void *ctx)
+{
+    servo_feedback_clear_stall();
+    wiper_protect_reset();
+}
+
+static void wiper_track(void *ctx, int duty, int since_ms)
+{
+    servo_feedback_track(duty, since_ms);
+}
+
+static int wiper_settle(void *ctx, int target, int elapsed_ms, int half_period_ms)
+{
+    int late_ms = servo_feedback_settle(target, elapsed_ms, half_period_ms);
+    health_beat(HEALTH_WIPER);
+    return late_ms;
+}
+
+static bool wiper_park_confirmed(void *ctx)
+{
+    return servo_feedback_confirm_park(LEDC_DUTY_MIN) && !servo_feedback_stalled();
+}
+
+static void console_print(void *ctx, const char *text)
+{
+    printf("%s\n", text);
+}
+
+static const wiper_io_t wiper_io = {
+    .set_duty = wiper_set_duty,
+    .fade = wiper_fade,
+    .fade_stop = wiper_fade_stop,
+    .wait_ms = wiper_wait_ms,
+    .wait_change = wiper_wait_change,
+    .now_ms = wiper_now_ms,
+    .faulted = wiper_faulted,
+    .clear_fault = wiper_clear_fault,
+    .track = wiper_track,
+    .settle = wiper_settle,
+    .park_confirmed = wiper_park_confirmed,
+    .print = console_print,
+};
 
 // Task to set wipers according to WIPER_CONTROL (potentiometer) and intermittence
 void wiper_task(void *pvParameter)
 {
-    while(executed != 3){
-        // if wiper is set to OFF, make motor stationary at minimum angle
-        if(wiper == 0){
-            ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, LEDC_DUTY_MIN);
-            ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
-            vTaskDelay(10/portTICK_PERIOD_MS);
-        }
-        
-        // if wiper is set to INT, rotate to 90 degrees and back at low speed
-        else if(wiper == 1){
-            int i;
-            for(i = LEDC_DUTY_MIN; i <= LEDC_DUTY_CENTER; i = i + 8){   // increment duty count by 8
-                ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, i);              // set duty cycle to new i-value
-                ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);              // update duty cycle
-                vTaskDelay((delay_low * 8)/portTICK_PERIOD_MS);         // wait 8 delay lengths
-            }
-            for(i = LEDC_DUTY_CENTER; i >= LEDC_DUTY_MIN; i = i - 8){   // increment duty count by 8
-                ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, i);              // set duty cycle to new i-value
-                ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);              // update duty cycle
-                vTaskDelay((delay_low * 8)/portTICK_PERIOD_MS);         // wait 8 delay lengths
-            }
-            /* the value 8 was calculated to make vTaskDelay value an integer 
-            and make duty cycle value (i) an integer
-            while maintaining the proper ratio for the expected speed*/
+    servo_feedback_init(LEDC_DUTY_MIN, LEDC_DUTY_CENTER);
 
-            // if intermittent SHORT, delay 1 second
-            if (wiper_int == 1){
-                vTaskDelay(1000/portTICK_PERIOD_MS);
-            }
-            // if intermittence MED, delay 3 seconds
-            else if (wiper_int == 2){
-                vTaskDelay(3000/portTICK_PERIOD_MS);
-            }
-            // if intermittence LONG, delay 5 seconds
-            else if (wiper_int == 3){
-                vTaskDelay(5000/portTICK_PERIOD_MS);
-            }
-        }
-            
-        // if wiper set to LOW, rotate to 90 degrees and back to min at low speed (3s period)
-        else if(wiper == 2){
-            int i;            
-            for(i = LEDC_DUTY_MIN; i <= LEDC_DUTY_CENTER; i = i + 8){   // increment duty count by 8
-                ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, i);              // set duty cycle to new i-value
-                ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);              // update duty cycle
-                vTaskDelay((delay_low * 8.0)/portTICK_PERIOD_MS);       // wait 8 delay lengths
-            }
-            for(i = LEDC_DUTY_CENTER; i >= LEDC_DUTY_MIN; i = i - 8){   // increment duty count by 8
-                ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, i);              // set duty cycle to new i-value
-                ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);              // update duty cycle
-                vTaskDelay((delay_low * 8.0)/portTICK_PERIOD_MS);       // wait 8 delay lengths
-            }
-            /* the value 8 was calculated to make vTaskDelay value an integer 
-            and make duty cycle value (i) an integer
-            while maintaining the proper ratio for the expected speed*/
-        }
+    // wake this task at the end of each fade segment
+    ledc_cbs_t callbacks = {
+        .fade_cb = wiper_fade_done,
+    };
+    ledc_cb_register(LEDC_MODE, LEDC_CHANNEL, &callbacks, NULL);
 
-        // if wiper set to HIGH, rotate to 90 degrees and back to min at high speed (1.2s period)
-        else if (wiper == 3){
-            int i;
-            for(i = LEDC_DUTY_MIN; i <= LEDC_DUTY_CENTER; i = i + 20){  // increment duty count by 20
-                ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, i);              // set duty cycle to new i-value
-                ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);              // update duty cycle
-                vTaskDelay((delay_high * 20.0)/portTICK_PERIOD_MS);     // wait 20 delay lengths
-            }
-            for(i = LEDC_DUTY_CENTER; i >= LEDC_DUTY_MIN; i = i - 20){  // decrement duty count by 20
-                ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, i);              // set duty cycle to new i-value
-                ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);              // update duty cycle
-                vTaskDelay((delay_high * 20.0)/portTICK_PERIOD_MS);     // wait 20 delay lengths
-            }
-            /* the value 20 was calculated to make vTaskDelay value an integer 
-            and make duty cycle value (i) an integer
-            while maintaining the proper ratio for the expected speed*/
-        }
-    }
+    wiper_engine_set_stop(&wiper_engine, CONFIG_WIPER_OFF_STOP, CONFIG_WIPER_ENGINE_OFF_STOP);
+
+    wiper_engine_run(&wiper_engine, &vehicle, &wiper_io);
+
+    health_stop(HEALTH_WIPER);
     vTaskDelete(NULL);
 }
 
-void app_main(void)
+// Task to copy the shown LCD page to the display, rewriting only the cells that changed
+static void display_task(void *pvParameter)
 {
+    // the controller's power-on init takes tens of ms, so it runs here rather than holding up
+    // app_main, and again after a restart in case a cut-off write left it out of nibble sync
+#if CONFIG_WIPER_INSTRUCTOR_LCD
+    hd44780_shared_init(&lcd_bus);      // only this task uses the bus, so a restart can't leave the lock held
+#endif
+    for (int i = 0; i < (int)(sizeof(lcd_panels) / sizeof(lcd_panels[0])); i++){
+        ESP_ERROR_CHECK(hd44780_init(lcd_panels[i]));
+    }
+#if CONFIG_WIPER_LCD_TIMED
+    if (lcd_timed.timer == NULL){       // the timer outlives a restart of this task
+        ESP_ERROR_CHECK(hd44780_timed_init(&lcd_timed));
+    }
+    lcd_pages_use_timed(&lcd_timed);
+#endif
+    boot_mark(BOOT_LCD);
+    lcd_pages_invalidate();     // a restart may have cut off a write, so rewrite every cell once
+
+    while(1){
+        health_beat(HEALTH_DISPLAY);
+        lcd_pages_flush(lcd_panels, sizeof(lcd_panels) / sizeof(lcd_panels[0]));
+        vTaskDelay(50/portTICK_PERIOD_MS);
+    }
+}
 
-    int wiper_adc_bits;                       // wiper potentiometer ADC reading (bits)
-    int wiper_adc_mV;                         // wiper potentiometer ADC reading (mV)
-    int int_wiper_adc_bits;                   // intermittent potent ADC reading (bits)
-    int int_wiper_adc_mV;                     // intermittent potent ADC reading (mV)
-
-
-    // set driver seat pin config to input and internal pullup
-    gpio_reset_pin(DSEAT_PIN);
-    gpio_set_direction(DSEAT_PIN, GPIO_MODE_INPUT);
-    gpio_pullup_en(DSEAT_PIN);
-
-    // set passenger seat pin config to input and internal pullup
-    gpio_reset_pin(PSEAT_PIN);
-    gpio_set_direction(PSEAT_PIN, GPIO_MODE_INPUT);
-    gpio_pullup_en(PSEAT_PIN);
-
-    // set driver belt pin config to input and internal pullup
-    gpio_reset_pin(DBELT_PIN);
-    gpio_set_direction(DBELT_PIN, GPIO_MODE_INPUT);
-    gpio_pullup_en(DBELT_PIN);
-
-    // set passenger belt pin config to input and internal pullup
-    gpio_reset_pin(PBELT_PIN);
-    gpio_set_direction(PBELT_PIN, GPIO_MODE_INPUT);
-    gpio_pullup_en(PBELT_PIN);
-
-    // set ignition button config to input and internal pullup
-    gpio_reset_pin(IGNITION_BUTTON);
-    gpio_set_direction(IGNITION_BUTTON, GPIO_MODE_INPUT);
-    gpio_pullup_en(IGNITION_BUTTON);
-
-    // set ready led pin config to output, level 0
-    gpio_reset_pin(READY_LED);
-    gpio_set_direction(READY_LED, GPIO_MODE_OUTPUT);
-
-    // set success led pin config to output, level 0
-    gpio_reset_pin(SUCCESS_LED);
-    gpio_set_direction(SUCCESS_LED, GPIO_MODE_OUTPUT);
-
-    //set alarm pin config to output, level 0
-    gpio_reset_pin(ALARM_PIN);
-    gpio_set_direction(ALARM_PIN, GPIO_MODE_OUTPUT);
-
-    // configure adc oneshot for wiper potent and intermittent potent
-    adc_oneshot_unit_init_cfg_t init_config1 = {
-        .unit_id = ADC_UNIT_1,
-    };                                                  // Unit configuration
-    adc_oneshot_unit_handle_t adc1_handle;              // Unit handle
-    adc_oneshot_new_unit(&init_config1, &adc1_handle);  // Populate unit handle
-
-    adc_oneshot_chan_cfg_t config = {
-        .atten = ADC_ATTEN,
-        .bitwidth = BITWIDTH
-    };                                                  // Channel config
-    adc_oneshot_config_channel                          // Configure channel
-    (adc1_handle, WIPER_CONTROL, &config);
-
-    adc_oneshot_config_channel
-    (adc1_handle, INT_WIPER_CONTROL, &config);
-
-    adc_cali_curve_fitting_config_t cali_config = {
-        .unit_id = ADC_UNIT_1,
-        .chan = WIPER_CONTROL,
-        .atten = ADC_ATTEN,
-        .bitwidth = BITWIDTH
-    };                                                  // Calibration config
-    adc_cali_handle_t adc1_cali_chan_handle;            // Calibration handle
-    adc_cali_create_scheme_curve_fitting                // Populate cal handle
-    (&cali_config, &adc1_cali_chan_handle);
-
-    // configuration structure for lcd
-    hd44780_t lcd =
-    {
-        .write_cb = NULL,
-        .font = HD44780_FONT_5X8,
-        .lines = 2,
-        .pins = {
-            .rs = GPIO_NUM_39,
-            .e  = GPIO_NUM_37,
-            .d4 = GPIO_NUM_36,
-            .d5 = GPIO_NUM_35,
-            .d6 = GPIO_NUM_48,
-            .d7 = GPIO_NUM_47,
-            .bl = HD44780_NOT_USED
+// fill the warnings page with the console warnings of an inhibited ignition, scrolled as marquees
+static void display_warnings(const vehicle_inputs_t *in)
+{
+    char reasons[LCD_TEXT_MAX + 1];
+
+    snprintf(reasons, sizeof(reasons), "%s%s%s%s",
+             in->pseat ? "" : "Passenger seat not occupied. ", in->dseat ? "" : "Driver seat not occupied. ",
+             in->pbelt ? "" : "Passenger seatbelt not fastened. ", in->dbelt ? "" : "Drivers seatbelt not fastened. ");
+    reasons[strlen(reasons) - 1] = '\0';                // drop the trailing space
+    lcd_pages_set(LCD_PAGE_WARNINGS, 0, "Ignition inhibited.");
+    lcd_pages_set(LCD_PAGE_WARNINGS, 1, reasons);
+}
+
+// fill the diagnostics page, true if there is a fault or a task restart worth showing
+static bool display_diag(void)
+{
+    health_stats_t stats;
+    char text[LCD_COLS + 1];
+    unsigned restarts = 0;
+    unsigned missed = 0;
+    int id;
+
+    for(id = 0; id < HEALTH_COUNT; id++){
+        if (health_get_stats(id, &stats)){
+            restarts += stats.restarts;
+            missed += stats.missed;
         }
+    }
+    snprintf(text, sizeof(text), "Fault: %s", wiper_protect_fault_name(wiper_protect_fault()));
+    lcd_pages_set(LCD_PAGE_DIAG, 0, text);
+    snprintf(text, sizeof(text), "Rst %u Miss %u", restarts, missed);
+    lcd_pages_set(LCD_PAGE_DIAG, 1, text);
+    return wiper_protect_fault() != WIPER_FAULT_NONE || restarts > 0;
+}
+
+// tasks restarted by the health supervisor if they stop beating
+#if CONFIG_WIPER_STATIC_ALLOC
+static StackType_t control_stack[CONTROL_STACK];
+static StackType_t display_stack[DISPLAY_STACK];
+static StackType_t wiper_stack[WIPER_STACK];
+static StaticTask_t control_tcb;
+static StaticTask_t display_tcb;
+static StaticTask_t wiper_tcb;
+#endif
+static const health_spec_t control_spec = {
+    .name = "Control_Task", .entry = control_task, .stack = CONTROL_STACK, .priority = 1, .deadline_ms = 500,
+#if CONFIG_WIPER_STATIC_ALLOC
+    .stack_buf = control_stack, .tcb = &control_tcb,
+#endif
+};
+static const health_spec_t display_spec = {
+    .name = "Display_Task", .entry = display_task, .stack = DISPLAY_STACK, .priority = 1, .deadline_ms = 1000,
+#if CONFIG_WIPER_STATIC_ALLOC
+    .stack_buf = display_stack, .tcb = &display_tcb,
+#endif
+};
+static health_spec_t wiper_spec = {
+    .name = "Wiper_Task", .entry = wiper_task, .stack = WIPER_STACK, .priority = 5,   // deadline set from the sweep time
+#if CONFIG_WIPER_STATIC_ALLOC
+    .stack_buf = wiper_stack, .tcb = &wiper_tcb,
+#endif
+};
+
+// control pass output to the indicator GPIOs, the display task and the console
+static void control_set_output(void *ctx, vehicle_output_t output, int level)
+{
+    static const buzzer_pattern_t alarm_patterns[] = {
+        [VEHICLE_ALARM_OFF]   = BUZZER_OFF,
+        [VEHICLE_ALARM_CHIRP] = BUZZER_CHIRP,
+        [VEHICLE_ALARM_BELT]  = BUZZER_BELT,
+        [VEHICLE_ALARM_START] = BUZZER_START,
     };
 
-    // initialize lcd
-    ESP_ERROR_CHECK(hd44780_init(&lcd));
+    if (output == VEHICLE_ALARM){
+        buzzer_play(alarm_patterns[level]);
+    }
+    else if (output == VEHICLE_READY_LED){
+        led_fx_set(LED_FX_READY, level ? LED_FX_BREATHE : LED_FX_OFF);     // slow pulse while ready
+    }
+    else{
+        led_fx_set(LED_FX_SUCCESS, level ? LED_FX_FADE_ON : LED_FX_FADE_OFF);
+    }
+}
 
-    // Set the LEDC peripheral configuration
-    ledc_initialize();
-    // Set duty to 3.75% (0 degrees)
-    ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, LEDC_DUTY_MIN);
-    // Update duty to apply the new value
-    ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
+static void control_lcd(void *ctx, int line, const char *text)
+{
+    lcd_pages_set(LCD_PAGE_STATUS, line, text);
+}
+
+static const vehicle_io_t control_io = {
+    .set_output = control_set_output,
+    .lcd = control_lcd,
+    .print = console_print,
+};
+
+// seats, belts and ignition as BUS_INPUT_* bits (buttons pull their pins low)
+static uint8_t read_inputs(void)
+{
+    return (gpio_get_level(DSEAT_PIN) == 0 ? BUS_INPUT_DSEAT : 0) |
+           (gpio_get_level(PSEAT_PIN) == 0 ? BUS_INPUT_PSEAT : 0) |
+           (gpio_get_level(DBELT_PIN) == 0 ? BUS_INPUT_DBELT : 0) |
+           (gpio_get_level(PBELT_PIN) == 0 ? BUS_INPUT_PBELT : 0) |
+           (gpio_get_level(IGNITION_BUTTON) == 0 ? BUS_INPUT_IGNITION : 0);
+}
+
+// seat, belt or ignition edge, the only producer of BUS_INPUTS
+static void input_isr(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+    bus_event_t event = { .topic = BUS_INPUTS, .inputs = read_inputs() };
+
+    bus_publish_from_isr(&event, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+// knob moved past its threshold, called by the analog task (the only producer of BUS_KNOB)
+static void knob_changed(analog_in_t input, int mv, void *ctx)
+{
+    bus_event_t event = { .topic = BUS_KNOB, .knob = { .input = input, .mv = mv } };
+
+    bus_publish(&event);
+}
+
+// BUS_VEHICLE listeners: the CAN bus, the telemetry endpoint and the event log
+static void vehicle_to_can(const bus_event_t *event, void *ctx)
+{
+    const bus_vehicle_t *v = &event->vehicle;
+    can_bus_state_t state = {
+        .engine = v->engine,
+        .ready = v->ready,
+        .occupancy = (v->inputs & BUS_INPUT_DSEAT ? CAN_SEAT_DRIVER : 0) | (v->inputs & BUS_INPUT_PSEAT ? CAN_SEAT_PASSENGER : 0) |
+                     (v->inputs & BUS_INPUT_DBELT ? CAN_BELT_DRIVER : 0) | (v->inputs & BUS_INPUT_PBELT ? CAN_BELT_PASSENGER : 0),
+        .wiper = v->wiper,
+        .wiper_int = v->wiper_int,
+        .fault = v->fault,
+    };
+
+    can_bus_publish(&state);
+}
+
+static void vehicle_to_telemetry(const bus_event_t *event, void *ctx)
+{
+    const bus_vehicle_t *v = &event->vehicle;
+    telemetry_state_t state = {
+        .engine = v->engine,
+        .wiper = v->wiper,
+        .int_delay_ms = v->wiper == 1 ? v->int_delay_ds * servo_speed_dwell_pct[v->speed_band] : 0,
+        .fault = v->fault,
+    };
+
+    telemetry_publish(&state);
+}
+
+static void vehicle_to_log(const bus_event_t *event, void *ctx)
+{
+    static bus_vehicle_t logged;            // only the control task publishes, so no lock
+
+    if (event->vehicle.engine != logged.engine){
+        event_log_add(EVENT_ENGINE_STATE, event->vehicle.engine);
+    }
+    if (event->vehicle.engine == 2 &&
+        (event->vehicle.wiper != logged.wiper || event->vehicle.wiper_int != logged.wiper_int)){
+        event_log_add(EVENT_WIPER_MODE, event->vehicle.wiper * 10 + event->vehicle.wiper_int);
+    }
+    logged = event->vehicle;
+}
+
+// engine state and wiper setting for a warm start after a brownout or watchdog reset
+static void vehicle_to_snapshot(const bus_event_t *event, void *ctx)
+{
+    warm_start_save_vehicle(event->vehicle.engine, event->vehicle.wiper, event->vehicle.wiper_int);
+}
+
+// new wiper setting or engine state: cut the fade in progress short so the wiper engine follows it.
+// A new INT delay only wakes a dwell, the sweep carries on undisturbed
+static void vehicle_to_wiper(const bus_event_t *event, void *ctx)
+{
+    static bus_vehicle_t seen;              // only the control task publishes, so no lock
+
+    if (event->vehicle.engine != seen.engine || event->vehicle.wiper != seen.wiper ||
+        (wiper_dwelling && event->vehicle.int_delay_ds != seen.int_delay_ds)){
+        xSemaphoreGive(wiper_wake);
+    }
+    seen = event->vehicle;
+}
+
+// Task to run the ignition state machine whenever an input, knob, CAN command or fault event arrives
+static void control_task(void *pvParameter)
+{
+    vehicle_inputs_t in = { .can_wiper = -1 };      // inputs for one control pass
+    bus_event_t event;
+    bus_event_t published = { .topic = BUS_VEHICLE };   // last BUS_VEHICLE sent
+    bool warned = false;                      // warnings page up after an inhibited start
+    bool fault_blink = false;                 // engine light blinking for a motor fault
+    int rotate_ms;                            // time into the status/diagnostics rotation
+    lcd_page_t page;
+
+    in.wiper_mv = analog_in_get_mv(ANALOG_WIPER);
+    in.int_wiper_mv = analog_in_get_mv(ANALOG_INT_WIPER);
 
     while (1){
-        
-        adc_oneshot_read
-        (adc1_handle, WIPER_CONTROL, &wiper_adc_bits);              // Read ADC bits (wiper)
-        
-        adc_cali_raw_to_voltage
-        (adc1_cali_chan_handle, wiper_adc_bits, &wiper_adc_mV);         // Convert to mV (wiper)
-
-        adc_oneshot_read
-        (adc1_handle, INT_WIPER_CONTROL, &int_wiper_adc_bits);           // Read ADC bits (wiper int)
-        
-        adc_cali_raw_to_voltage
-        (adc1_cali_chan_handle, int_wiper_adc_bits, &int_wiper_adc_mV); // Convert to mV (wiper int)
-
-
-        // Task Delay to prevent watchdog
-        vTaskDelay(10 / portTICK_PERIOD_MS);
-
-        // initialize variables in relation to GPIO pin inputs
-        dseat = gpio_get_level(DSEAT_PIN)==0;
-        pseat = gpio_get_level(PSEAT_PIN)==0;
-        dbelt = gpio_get_level(DBELT_PIN)==0;
-        pbelt = gpio_get_level(PBELT_PIN)==0;
-        ignition = gpio_get_level(IGNITION_BUTTON)==0;
-
-        // if the driver seat button is pressed, print the welcome message once
-        if (dseat){
-            if (executed == 0){     // if executed equals 0, print welcome message
-                printf("Welcome to enhanced alarm system model 218-W25 \n"); 
-                executed = 1;       // set executed = 1 so welcome message only prints once
+        // sleep until something changes, waking every CONTROL_IDLE_MS for the CAN command timeout
+        // and the diagnostics page, heartbeat for the task watchdog and supervisor
+        if (bus_receive(&control_bus, &event, pdMS_TO_TICKS(CONTROL_IDLE_MS))){
+            if (event.topic == BUS_INPUTS){
+                vTaskDelay(VEHICLE_CONTROL_MS / portTICK_PERIOD_MS);    // let the contacts settle
             }
+            do {
+                if (event.topic == BUS_KNOB && event.knob.input == ANALOG_WIPER){
+                    in.wiper_mv = event.knob.mv;
+                }
+                else if (event.topic == BUS_KNOB && event.knob.input == ANALOG_INT_WIPER){
+                    in.int_wiper_mv = event.knob.mv;
+                }
+            } while (bus_receive(&control_bus, &event, 0));
         }
-
-        // if all of the conditions are met
-        if (dseat && pseat && dbelt && pbelt){
-            //set ready led to ON
-            if (executed == 1 && ready_led == 0){
-                gpio_set_level(READY_LED, 1);
-                ready_led = 1;
-            }
-            // if ignition button is pressed while all conditions are met
-            if (ignition == true && executed == 1){
-                // turn on ignition LED and turn off ready LED
-                gpio_set_level(SUCCESS_LED, 1);
-                gpio_set_level(READY_LED, 0);
-                gpio_set_level(ALARM_PIN, 0);
-                // print engine started message once
-                printf("Engine started!\n");
-                executed = 2;       // set executed = 2 so engine started message only prints once
-            }
+        health_beat(HEALTH_CONTROL);
+
+        // button levels are read now rather than taken from the events, so a bounce that
+        // overflowed the ring can't leave a stale level behind
+        uint8_t inputs = read_inputs();
+        in.dseat = inputs & BUS_INPUT_DSEAT;
+        in.pseat = inputs & BUS_INPUT_PSEAT;
+        in.dbelt = inputs & BUS_INPUT_DBELT;
+        in.pbelt = inputs & BUS_INPUT_PBELT;
+        in.ignition = inputs & BUS_INPUT_IGNITION;
+
+        // a wiper command from the CAN bus and a motor fault override the knobs
+        if (!can_bus_wiper_command(&in.can_wiper, &in.can_wiper_int)){
+            in.can_wiper = -1;
         }
-            
-        // otherwise (at least one condition is not satisfied)
-        else{
-            // set ready LED to OFF and set variable ready_led to 0
-            gpio_set_level(READY_LED,0);
-            ready_led = 0;
-            // if ignition button is pressed while conditions are not satisfied
-            if (ignition==true && executed < 2){
-                    // turn on alarm buzzer
-                    gpio_set_level(ALARM_PIN, 1);
-                    printf("Ignition inhibited.\n");
-                    // check which conditions are not met, print corresponding message
-                    if (!pseat){
-                        printf("Passenger seat not occupied.\n");
-                    }
-                    if (!dseat){
-                        printf("Driver seat not occupied.\n");
-                    }
-                    if (!pbelt){
-                        printf("Passenger seatbelt not fastened.\n");
-                    }
-                    if (!dbelt){
-                        printf("Drivers seatbelt not fastened.\n");
-                    }
-                    executed = 4;   // set executed = 4 so messages print only once
-                
+        in.fault_name = wiper_protect_fault() != WIPER_FAULT_NONE ? wiper_protect_fault_name(wiper_protect_fault()) : NULL;
+        in.speed_band = wheel_speed_band();
+
+        int was_executed = vehicle.executed;
+        vehicle_step(&vehicle, &in, &control_io);
+        boot_mark(BOOT_READY);
+        // nobody in the car and the engine off: the ULP watches the seat in deep sleep (when enabled)
+        seat_watch_idle(vehicle.executed != 2 && !in.dseat && !in.pseat && !in.ignition);
+
+        // engine light: steady while the engine runs, fast blink while the wiper motor is cut
+        if ((vehicle.executed == 2 && in.fault_name != NULL) != fault_blink){
+            fault_blink = !fault_blink;
+            if (vehicle.executed == 2){
+                led_fx_set(LED_FX_SUCCESS, fault_blink ? LED_FX_BLINK : LED_FX_ON);
             }
         }
-        
-        // if executed = 4 (failed ignition) and ignition button is released
-        if (ignition == false && executed == 4){
-            // reset to state after welcome message, testing for conditions
-            executed = 1;
-        }
 
-        // if iginition successful, set wipers according to potentiometers
-        if(executed == 2){
-            // print "Wipers: " on LCD screen, line 1
-            hd44780_gotoxy(&lcd, 0, 0);
-            hd44780_puts(&lcd, "Wipers: ");
-
-            // create wiper task
-            xTaskCreate(wiper_task, "Wiper_Task", 2048, NULL, 5, NULL);
-
-            // if potentiometer set to off, write "wipers: off" on LCD, set wiper = 0
-            if(wiper_adc_mV < WIPER_POTENT_OFF){
-                hd44780_gotoxy(&lcd, 8, 0);
-                hd44780_puts(&lcd, "OFF ");
-                hd44780_gotoxy(&lcd, 0, 1);
-                hd44780_puts(&lcd, "          ");
-                wiper = 0;
-            }
-            
-            // if potentiometer set to int, write "wipers: int" on LCD, set wiper = 1
-            else if(wiper_adc_mV >= WIPER_POTENT_OFF && wiper_adc_mV < WIPER_POTENT_LOW){
-                hd44780_gotoxy(&lcd, 8, 0);
-                hd44780_puts(&lcd, "INT  ");
-                wiper = 1;
-                // if int short, write "int: short" on LCD, set wiper_int = 1
-                if (int_wiper_adc_mV < WIPER_INT_SHORT){
-                    hd44780_gotoxy(&lcd, 0, 1);
-                    hd44780_puts(&lcd, "INT: SHORT");
-                    wiper_int = 1;
-                    }
-                
-                // if int medium, write "int: med" on LCD, set wiper_int = 2
-                else if (int_wiper_adc_mV >= WIPER_INT_SHORT && int_wiper_adc_mV < WIPER_INT_LONG){
-                    hd44780_gotoxy(&lcd, 0, 1);
-                    hd44780_puts(&lcd, "INT: MED  ");
-                    wiper_int = 2;
-                    }
-                
-                // if int long, write "int: long" on LCD, set wiper_int = 3
-                else if (int_wiper_adc_mV >= WIPER_INT_LONG){
-                    hd44780_gotoxy(&lcd, 0, 1);
-                    hd44780_puts(&lcd, "INT: LONG  ");
-                    wiper_int = 3;
-                    }
-            }
-                
-            // if wipers set to low, write "wipers: low" on LCD, set wiper = 2
-            else if(wiper_adc_mV >= WIPER_POTENT_LOW && wiper_adc_mV < WIPER_POTENT_HI){
-                hd44780_gotoxy(&lcd, 8, 0);
-                hd44780_puts(&lcd, "LOW ");
-                hd44780_gotoxy(&lcd, 0, 1);
-                hd44780_puts(&lcd, "          ");
-                wiper = 2;
-            }
-
-            // if wipers set to high, write "wipers: high" on LCD, set wiper = 3
-            else if(wiper_adc_mV >= WIPER_POTENT_HI){
-                hd44780_gotoxy(&lcd, 8, 0);
-                hd44780_puts(&lcd, "HIGH");
-                hd44780_gotoxy(&lcd, 0, 1);
-                hd44780_puts(&lcd, "          ");
-                wiper = 3;      
-            }
+        // create wiper task once the engine is running
+        if (vehicle.executed == 2 && !health_running(HEALTH_WIPER)){
+            health_start(HEALTH_WIPER, &wiper_spec);
         }
 
+        // warnings page from an inhibited start until the driver is ready, then the status page,
+        // rotating with diagnostics while the engine runs with a motor fault or a restarted task
+        if (vehicle.executed == 4 && was_executed != 4){
+            display_warnings(&in);
+            warned = true;
+        }
+        if (vehicle.ready_led || vehicle.executed == 2 || vehicle.executed == 3){
+            warned = false;
+        }
+        if (warned){
+            page = LCD_PAGE_WARNINGS;
+        }
+        else if (vehicle.executed == 2 && display_diag()){
+            rotate_ms = pdTICKS_TO_MS(xTaskGetTickCount()) % (2 * DISPLAY_ROTATE_MS);
+            page = rotate_ms < DISPLAY_ROTATE_MS ? LCD_PAGE_STATUS : LCD_PAGE_DIAG;
+        }
+        else{
+            page = LCD_PAGE_STATUS;
+        }
+        if (page != lcd_pages_shown()){
+            lcd_pages_show(page);
+        }
 
-
-        // if ignition is successfully started and then ignition is released, set ignition_off = 1
-        if (executed == 2 && ignition == false){
-            ignition_off = 1;
+        // task timing, wiper tracking, bus figures and the event log of the drive
+        if (vehicle.executed == 3 && was_executed != 3){
+            health_print();
+            lcd_pages_print_stats();
+            servo_feedback_print_stats();
+            can_bus_print_stats();
+            event_log_print();
         }
 
-        // if ignition_off = 1 and inition is pressed, turn off all LEDs
-        if (ignition_off==1 && ignition == true){
-            gpio_set_level(SUCCESS_LED,0);          // turn off ignition
-            hd44780_clear(&lcd);                    // turn off wiper lcd
-            executed = 3;                           // set executed = 3 to keep LEDs off, exit wiper task loop
+        // tell the listeners when the vehicle state changes
+        bus_vehicle_t state = {
+            .engine = vehicle.executed,
+            .ready = vehicle.ready_led,
+            .inputs = inputs,
+            .wiper = vehicle.wiper,
+            .wiper_int = vehicle.wiper_int,
+            .fault = wiper_protect_fault(),
+            .speed_band = vehicle.speed_band,
+            .int_delay_ds = vehicle.int_delay_ms / 100,
+        };
+        if (memcmp(&state, &published.vehicle, sizeof(state)) != 0){
+            published.vehicle = state;
+            bus_publish(&published);
         }
     }
 }
 
+void app_main(void)
+{
+#if CONFIG_WIPER_REPLAY
+    // check the ignition and wiper logic against the embedded spec suite before touching any hardware
+    extern const char spec_suite_start[] asm("_binary_spec_suite_txt_start");
+    replay_check(spec_suite_start, NULL);
+#endif
+
+    boot_mark(BOOT_APP_MAIN);
+    // a ULP wakeup from deep sleep: take the seat and ignition pins back and report the sleep
+    seat_watch_init(DSEAT_PIN, IGNITION_BUTTON);
+
+    // wire up the event bus before any producer starts
+    ESP_ERROR_CHECK(bus_subscribe(&control_bus, BUS_MASK(BUS_INPUTS) | BUS_MASK(BUS_KNOB) |
+                                                BUS_MASK(BUS_CAN_COMMAND) | BUS_MASK(BUS_FAULT)));
+    ESP_ERROR_CHECK(bus_listen(BUS_MASK(BUS_VEHICLE), vehicle_to_can, NULL));
+    ESP_ERROR_CHECK(bus_listen(BUS_MASK(BUS_VEHICLE), vehicle_to_telemetry, NULL));
+    ESP_ERROR_CHECK(bus_listen(BUS_MASK(BUS_VEHICLE), vehicle_to_log, NULL));
+    ESP_ERROR_CHECK(bus_listen(BUS_MASK(BUS_VEHICLE), vehicle_to_wiper, NULL));
+    ESP_ERROR_CHECK(bus_listen(BUS_MASK(BUS_VEHICLE), vehicle_to_snapshot, NULL));
+    wiper_wake = xSemaphoreCreateBinaryStatic(&wiper_wake_buf);
+    ESP_ERROR_CHECK(analog_in_subscribe(ANALOG_WIPER, knob_changed, NULL));
+    ESP_ERROR_CHECK(analog_in_subscribe(ANALOG_INT_WIPER, knob_changed, NULL));
+
+    // seats, belts and ignition: inputs with internal pullups, interrupting on every edge
+    gpio_config_t input_conf = {
+        .pin_bit_mask = (1ULL << DSEAT_PIN) | (1ULL << PSEAT_PIN) | (1ULL << DBELT_PIN) | (1ULL << PBELT_PIN) | (1ULL << IGNITION_BUTTON),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&input_conf));
+
+    // ready led, success led and alarm: outputs, level 0 until their LEDC channels take them
+    gpio_config_t output_conf = {
+        .pin_bit_mask = (1ULL << READY_LED) | (1ULL << SUCCESS_LED) | (1ULL << ALARM_PIN),
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&output_conf));
+
+    // publish every edge of the seat, belt and ignition inputs
+    ESP_ERROR_CHECK(gpio_install_isr_service(0));
+    static const gpio_num_t input_pins[] = { DSEAT_PIN, PSEAT_PIN, DBELT_PIN, PBELT_PIN, IGNITION_BUTTON };
+    for (int i = 0; i < (int)(sizeof(input_pins) / sizeof(input_pins[0])); i++){
+        ESP_ERROR_CHECK(gpio_isr_handler_add(input_pins[i], input_isr, NULL));
+    }
+    boot_mark(BOOT_INPUTS);
+
+#if CONFIG_WIPER_INT_CURVE
+    vehicle.int_curve = true;               // INT delay from the knob curve
+#endif
+
+    // a brownout or watchdog reset in the middle of a drive leaves the arm where it was
+    warm_state_t warm;
+    bool warm_start = warm_start_restore(&warm);
+    int servo_duty = warm_start ? warm_start_duty(&warm) : LEDC_DUTY_MIN;
+
+    // Set the LEDC peripheral configuration, the first pulse already holds the arm at 0 degrees (or where it was)
+    ledc_initialize(servo_duty);
+    // the snapshot of this boot starts with the arm where the first pulse holds it, so a reset before the
+    // first sweep (or in a crash loop) restores that instead of a servo position that was never saved
+    warm_start_save_servo(servo_duty, servo_duty, 0);
+    // alarm buzzer and indicator LED effects on the other LEDC timers and channels
+    ESP_ERROR_CHECK(buzzer_init(ALARM_PIN));
+    ESP_ERROR_CHECK(led_fx_init(READY_LED, SUCCESS_LED));
+
+    // warm start: carry on with the drive, the wiper task sweeps on from the arm's angle
+    if (warm_start && warm.engine == 2){
+        vehicle.executed = 2;
+        vehicle.wiper = warm.wiper;
+        vehicle.wiper_int = warm.wiper_int;
+        wiper_engine_resume_at(&wiper_engine, servo_duty, warm.duty_to >= warm.duty_from);
+        led_fx_set(LED_FX_SUCCESS, LED_FX_ON);
+        printf("Warm start: engine running, wipers %d, arm at %d counts.\n", warm.wiper, servo_duty - LEDC_DUTY_MIN);
+    }
+    // engine off with the arm out: bring it home at LOW speed
+    else if (servo_duty != LEDC_DUTY_MIN){
+        int park_ms = servo_profile_low.half_period_ms * (servo_duty - LEDC_DUTY_MIN) / (LEDC_DUTY_CENTER - LEDC_DUTY_MIN);
+        ESP_ERROR_CHECK(ledc_set_fade_with_time(LEDC_MODE, LEDC_CHANNEL, LEDC_DUTY_MIN, park_ms));
+        ESP_ERROR_CHECK(ledc_fade_start(LEDC_MODE, LEDC_CHANNEL, LEDC_FADE_NO_WAIT));
+        warm_start_save_servo(servo_duty, LEDC_DUTY_MIN, park_ms);
+        printf("Warm start: parking the arm from %d counts.\n", servo_duty - LEDC_DUTY_MIN);
+    }
+    // watch the wiper motor for overcurrent and stalls
+    wiper_protect_init(wiper_cutoff);
+    boot_mark(BOOT_SERVO);
+
+    // start DMA sampling of the wiper potent, intermittent potent (and servo feedback)
+    ESP_ERROR_CHECK(analog_in_init());
+    // wheel speed pulses on the pulse counter (when enabled in menuconfig)
+    ESP_ERROR_CHECK(wheel_speed_init());
+
+    // run the control, display and wiper tasks under the health supervisor, parking the wipers on a restart
+    health_init(wiper_park);
+    wiper_spec.deadline_ms = servo_profile_low.half_period_ms + 1000;   // longest gap is one fade segment
+    health_start(HEALTH_CONTROL, &control_spec);
+    health_start(HEALTH_DISPLAY, &display_spec);    // initialises the LCD in the background
+    boot_mark(BOOT_TASKS);
+    // vehicle bus node (when enabled in menuconfig)
+    ESP_ERROR_CHECK(can_bus_init());
+    // Wi-Fi status endpoint (when enabled in menuconfig)
+    ESP_ERROR_CHECK(telemetry_init());
+}
+
 // function to configure and initialize ledc
-static void ledc_initialize(void)
+static void ledc_initialize(int duty)
 {
     // Prepare and then apply the LEDC PWM timer configuration
     ledc_timer_config_t ledc_timer = {
         .speed_mode       = LEDC_MODE,
         .duty_resolution  = LEDC_DUTY_RES,
         .timer_num        = LEDC_TIMER,
-        .freq_hz          = LEDC_FREQUENCY,  // Set output frequency at 50 Hz
+        .freq_hz          = LEDC_FREQUENCY,  // Set output frequency (50 Hz)
         .clk_cfg          = LEDC_AUTO_CLK
     };
     ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
+    printf("Servo PWM: %d-bit duty, %d counts for 90 degrees.\n", LEDC_DUTY_RES, LEDC_DUTY_CENTER - LEDC_DUTY_MIN);
 
     // Prepare and then apply the LEDC PWM channel configuration
     ledc_channel_config_t ledc_channel = {
@@ -428,8 +742,11 @@ static void ledc_initialize(void)
         .timer_sel      = LEDC_TIMER,
         .intr_type      = LEDC_INTR_DISABLE,
         .gpio_num       = LEDC_OUTPUT_IO,
-        .duty           = 0, // Set duty to 0%
+        .duty           = duty,          // 3.75% (0 degrees) unless a warm start found the arm elsewhere
         .hpoint         = 0
     };
-    ledc_channel_config(&ledc_channel);
+    ESP_ERROR_CHECK(ledc_channel_config(&ledc_channel));
+
+    // sweeps run on the hardware fade engine
+    ESP_ERROR_CHECK(ledc_fade_func_install(0));
 }
\ No newline at end of file
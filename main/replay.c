@@ -0,0 +1,493 @@
+#include "replay.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vehicle.h"
+#include "wiper_engine.h"
+
+#define REPLAY_LINE_MAX     (128)       // longest suite or trace line
+
+static const char *output_names[VEHICLE_OUTPUT_COUNT] = {
+    [VEHICLE_READY_LED]   = "ready",
+    [VEHICLE_SUCCESS_LED] = "success",
+    [VEHICLE_ALARM]       = "alarm",
+};
+
+typedef struct {
+    char name[32];              // scenario name
+    const char *input;          // next line to look at for '<' inputs
+    const char *expect;         // next line to look at for '>' outputs
+    const char *block_end;      // start of the next scenario
+    FILE *record;               // write outputs here instead of comparing
+    bool stopped;               // the end input has been reached
+    bool failed;
+    int outputs;                // traced outputs
+    int now_ms;
+    int next_tick_ms;           // time of the next control pass
+    int next_input_ms;          // time of the pending input, -1 once they are used up
+    char pending[REPLAY_LINE_MAX];
+    vehicle_t vehicle;
+    vehicle_inputs_t in;
+    vehicle_io_t vehicle_io;
+    wiper_engine_t engine;
+    int output_level[VEHICLE_OUTPUT_COUNT];
+    char lcd[2][17];
+    int duty;
+    bool watching;              // a fade is running: stop the clock when the wiper command changes
+    bool dwelling;              // an INT dwell is running: also stop it when the INT delay changes
+    int watch_wiper;
+    int watch_executed;
+    int watch_delay;
+    char fault_name[16];
+    int pulse_hz;               // simulated wheel speed pulses
+    int pulse_milli;            // thousandths of a pulse since the last speed sample
+    vehicle_speed_t speed;
+} replay_t;
+
+// copy the line at p into buf (without the newline), returns the start of the next line or NULL at the end
+static const char *replay_line(const char *p, const char *end, char *buf)
+{
+    int len = 0;
+
+    if (p == NULL || p >= end || *p == '\0'){
+        return NULL;
+    }
+    while (p < end && *p != '\0' && *p != '\n'){
+        if (*p != '\r' && len < REPLAY_LINE_MAX - 1){
+            buf[len++] = *p;
+        }
+        p++;
+    }
+    while (len > 0 && buf[len - 1] == ' '){
+        len--;                  // editors strip trailing spaces, so they never count
+    }
+    buf[len] = '\0';
+    return (p < end && *p == '\n') ? p + 1 : p;
+}
+
+// start of the next "scenario" line at or after p, or the end of the suite
+static const char *replay_next_block(const char *p)
+{
+    while (*p != '\0'){
+        if (strncmp(p, "scenario ", 9) == 0){
+            return p;
+        }
+        p = strchr(p, '\n');
+        if (p == NULL){
+            break;
+        }
+        p++;
+    }
+    return p == NULL ? "" : p;
+}
+
+// trace one output: record it, or compare it with the next expected line
+static void replay_emit(replay_t *r, const char *output)
+{
+    char line[REPLAY_LINE_MAX];
+    char expected[REPLAY_LINE_MAX];
+
+    snprintf(line, sizeof(line), "%d %s", r->now_ms, output);
+    for (int len = strlen(line); len > 0 && line[len - 1] == ' '; len--){
+        line[len - 1] = '\0';
+    }
+    r->outputs++;
+
+    if (r->record != NULL){
+        fprintf(r->record, "> %s\n", line);
+        return;
+    }
+    if (r->failed){
+        return;                 // only the first difference is reported
+    }
+    while ((r->expect = replay_line(r->expect, r->block_end, expected)) != NULL){
+        if (expected[0] == '>'){
+            if (strcmp(expected + 2, line) != 0){
+                printf("Replay %s: expected \"%s\", got \"%s\"\n", r->name, expected + 2, line);
+                r->failed = true;
+            }
+            return;
+        }
+    }
+    printf("Replay %s: unexpected \"%s\"\n", r->name, line);
+    r->failed = true;
+}
+
+// load the next '<' input line
+static void replay_next_input(replay_t *r)
+{
+    char line[REPLAY_LINE_MAX];
+
+    r->next_input_ms = -1;
+    while ((r->input = replay_line(r->input, r->block_end, line)) != NULL){
+        if (line[0] == '<'){
+            char *rest;
+            r->next_input_ms = (int)strtol(line + 1, &rest, 10);
+            snprintf(r->pending, sizeof(r->pending), "%s", rest + strspn(rest, " "));
+            return;
+        }
+    }
+}
+
+// apply one input, "name value"
+static void replay_apply(replay_t *r, const char *input)
+{
+    char name[16];
+    char value[16];
+    int level = 0;
+    int extra = 0;
+
+    value[0] = '\0';
+    if (sscanf(input, "%15s %15s %d", name, value, &extra) < 1){
+        return;
+    }
+    level = atoi(value);
+
+    if (strcmp(name, "end") == 0){
+        r->stopped = true;
+    }
+    else if (strcmp(name, "dseat") == 0){
+        r->in.dseat = level == 0;
+    }
+    else if (strcmp(name, "pseat") == 0){
+        r->in.pseat = level == 0;
+    }
+    else if (strcmp(name, "dbelt") == 0){
+        r->in.dbelt = level == 0;
+    }
+    else if (strcmp(name, "pbelt") == 0){
+        r->in.pbelt = level == 0;
+    }
+    else if (strcmp(name, "ignition") == 0){
+        r->in.ignition = level == 0;
+    }
+    else if (strcmp(name, "wiper") == 0){
+        r->in.wiper_mv = level;
+    }
+    else if (strcmp(name, "int") == 0){
+        r->in.int_wiper_mv = level;
+    }
+    else if (strcmp(name, "can") == 0){
+        r->in.can_wiper = strcmp(value, "release") == 0 ? -1 : level;
+        r->in.can_wiper_int = extra;
+    }
+    else if (strcmp(name, "stop") == 0){
+        char policy[16] = "";
+        sscanf(input, "%*s %*s %15s", policy);
+        wiper_stop_t stop = strcmp(policy, "park") == 0 ? WIPER_STOP_PARK :
+                            strcmp(policy, "freeze") == 0 ? WIPER_STOP_FREEZE : WIPER_STOP_FINISH;
+        if (strcmp(value, "engine") == 0){
+            r->engine.engine_off_stop = stop;
+        }
+        else{
+            r->engine.off_stop = stop;
+        }
+    }
+    else if (strcmp(name, "intcurve") == 0){
+        r->vehicle.int_curve = strcmp(value, "on") == 0;
+    }
+    else if (strcmp(name, "pulses") == 0){
+        r->pulse_hz = level;
+    }
+    else if (strcmp(name, "fault") == 0){
+        snprintf(r->fault_name, sizeof(r->fault_name), "%s", value);
+        r->in.fault_name = strcmp(value, "none") == 0 ? NULL : r->fault_name;
+    }
+    else{
+        printf("Replay %s: unknown input \"%s\"\n", r->name, input);
+        r->failed = true;
+    }
+}
+
+// advance the virtual clock, running every control pass on the way, false once the scenario has ended
+static bool replay_advance(replay_t *r, int ms)
+{
+    int until = r->now_ms + ms;
+
+    while (!r->stopped && r->next_tick_ms <= until){
+        r->now_ms = r->next_tick_ms;
+        while (!r->stopped && r->next_input_ms >= 0 && r->next_input_ms <= r->now_ms){
+            replay_apply(r, r->pending);
+            replay_next_input(r);
+        }
+        if (r->stopped){
+            break;
+        }
+        // the pulse counter is read every SERVO_SPEED_SAMPLE_MS, like the speed timer does
+        r->pulse_milli += r->pulse_hz * VEHICLE_CONTROL_MS;
+        if (r->now_ms % SERVO_SPEED_SAMPLE_MS == 0){
+            r->in.speed_band = vehicle_speed_sample(&r->speed, r->pulse_milli / 1000);
+            r->pulse_milli %= 1000;
+        }
+        vehicle_step(&r->vehicle, &r->in, &r->vehicle_io);
+        r->next_tick_ms += VEHICLE_CONTROL_MS;
+        if (r->watching && (r->vehicle.wiper != r->watch_wiper || r->vehicle.executed != r->watch_executed ||
+                            (r->dwelling && r->vehicle.int_delay_ms / 100 != r->watch_delay))){
+            return true;        // the wiper task is woken here, now_ms is the time of the change
+        }
+    }
+    if (!r->stopped){
+        r->now_ms = until;
+    }
+    return !r->stopped;
+}
+
+// vehicle outputs, traced when they change
+static void replay_set_output(void *ctx, vehicle_output_t output, int level)
+{
+    replay_t *r = ctx;
+    char text[32];
+
+    if (r->output_level[output] != level){
+        r->output_level[output] = level;
+        snprintf(text, sizeof(text), "led %s %d", output_names[output], level);
+        replay_emit(r, text);
+    }
+}
+
+static void replay_lcd(void *ctx, int line, const char *text)
+{
+    replay_t *r = ctx;
+    char padded[17];
+    char trace[32];
+
+    snprintf(padded, sizeof(padded), "%-16s", text);
+    if (strcmp(r->lcd[line], padded) != 0){
+        memcpy(r->lcd[line], padded, sizeof(padded));
+        snprintf(trace, sizeof(trace), "lcd %d \"%s\"", line, padded);
+        replay_emit(r, trace);
+    }
+}
+
+static void replay_print(void *ctx, const char *text)
+{
+    char trace[REPLAY_LINE_MAX];
+
+    snprintf(trace, sizeof(trace), "print %s", text);
+    replay_emit(ctx, trace);
+}
+
+static const vehicle_io_t replay_vehicle_io = {
+    .set_output = replay_set_output,
+    .lcd = replay_lcd,
+    .print = replay_print,
+};
+
+// servo outputs on the virtual clock
+static void replay_set_duty(void *ctx, int duty)
+{
+    replay_t *r = ctx;
+    char trace[32];
+
+    if (r->duty != duty){
+        r->duty = duty;
+        snprintf(trace, sizeof(trace), "duty %d", duty);
+        replay_emit(r, trace);
+    }
+}
+
+// like the fade engine, step the duty once every cycle_num periods until a new wiper command
+static bool replay_fade(void *ctx, int duty, const servo_fade_t *segment, int segment_ms)
+{
+    replay_t *r = ctx;
+    char trace[32];
+    int from = r->duty;
+    int start = r->now_ms;
+    bool running;
+
+    snprintf(trace, sizeof(trace), "fade %d %d", duty, segment_ms);
+    replay_emit(r, trace);
+    r->watching = true;
+    r->watch_wiper = r->vehicle.wiper;
+    r->watch_executed = r->vehicle.executed;
+    running = replay_advance(r, segment_ms);
+    r->watching = false;
+
+    r->duty = duty;
+    if (running && r->now_ms - start < segment_ms){
+        int steps = (r->now_ms - start) * SERVO_FREQUENCY_HZ / 1000 / segment->cycle_num;
+        r->duty = from + (duty > from ? 1 : -1) * segment->scale * steps;
+        snprintf(trace, sizeof(trace), "stop %d", r->duty);
+        replay_emit(r, trace);
+    }
+    return running;
+}
+
+static int replay_fade_stop(void *ctx)
+{
+    return ((replay_t *)ctx)->duty;
+}
+
+static bool replay_wait_ms(void *ctx, int ms)
+{
+    return replay_advance(ctx, ms);
+}
+
+static bool replay_wait_change(void *ctx, int ms)
+{
+    replay_t *r = ctx;
+    bool running;
+
+    r->watching = true;
+    r->dwelling = true;
+    r->watch_wiper = r->vehicle.wiper;
+    r->watch_executed = r->vehicle.executed;
+    r->watch_delay = r->vehicle.int_delay_ms / 100;    // the bus carries 100 ms units
+    running = replay_advance(r, ms);
+    r->watching = false;
+    r->dwelling = false;
+    return running;
+}
+
+static int replay_now_ms(void *ctx)
+{
+    return ((replay_t *)ctx)->now_ms;
+}
+
+static bool replay_faulted(void *ctx)
+{
+    return ((replay_t *)ctx)->in.fault_name != NULL;
+}
+
+static void replay_clear_fault(void *ctx)
+{
+    ((replay_t *)ctx)->in.fault_name = NULL;
+}
+
+static void replay_track(void *ctx, int duty, int since_ms)
+{
+    // the modelled arm always keeps up
+}
+
+static int replay_settle(void *ctx, int target, int elapsed_ms, int half_period_ms)
+{
+    return 0;                   // the modelled arm is always on time
+}
+
+static bool replay_park_confirmed(void *ctx)
+{
+    return true;
+}
+
+static const wiper_io_t replay_wiper_io = {
+    .set_duty = replay_set_duty,
+    .fade = replay_fade,
+    .fade_stop = replay_fade_stop,
+    .wait_ms = replay_wait_ms,
+    .wait_change = replay_wait_change,
+    .now_ms = replay_now_ms,
+    .faulted = replay_faulted,
+    .clear_fault = replay_clear_fault,
+    .track = replay_track,
+    .settle = replay_settle,
+    .park_confirmed = replay_park_confirmed,
+    .print = replay_print,
+};
+
+// run the scenario starting at block, returns true if its outputs matched
+static bool replay_scenario(replay_t *r, const char *block, FILE *record)
+{
+    char line[REPLAY_LINE_MAX];
+    bool wiper_started = false;
+    int blank_lines = 0;
+    wiper_io_t wiper_io = replay_wiper_io;
+
+    memset(r, 0, sizeof(*r));
+    sscanf(block + 9, "%31s", r->name);
+    r->block_end = replay_next_block(strchr(block, '\n') ? strchr(block, '\n') + 1 : "");
+    r->input = block;
+    r->expect = block;
+    r->record = record;
+    r->next_tick_ms = VEHICLE_CONTROL_MS;   // the control task waits before its first pass
+    r->in.can_wiper = -1;
+    r->duty = SERVO_DUTY_PARK;              // app_main parks the servo before any task starts
+    r->vehicle_io = replay_vehicle_io;
+    r->vehicle_io.ctx = r;
+    wiper_io.ctx = r;
+
+    // in record mode everything but the old outputs is copied through first, blank lines
+    // at the end of the block go after the new outputs
+    if (record != NULL){
+        for (const char *p = block; (p = replay_line(p, r->block_end, line)) != NULL; ){
+            if (line[0] == '\0'){
+                blank_lines++;
+            }
+            else if (line[0] != '>'){
+                for(; blank_lines > 0; blank_lines--){
+                    fputc('\n', record);
+                }
+                fprintf(record, "%s\n", line);
+            }
+        }
+    }
+    replay_next_input(r);
+
+    // control passes until the engine starts, then the wiper engine drives the clock through its waits
+    while (!r->stopped){
+        if (r->vehicle.executed == 2 && !wiper_started){
+            wiper_started = true;
+            wiper_engine_run(&r->engine, &r->vehicle, &wiper_io);
+            continue;
+        }
+        replay_advance(r, VEHICLE_CONTROL_MS);
+    }
+
+    for(; blank_lines > 0; blank_lines--){
+        fputc('\n', record);
+    }
+    if (record == NULL && !r->failed){
+        while ((r->expect = replay_line(r->expect, r->block_end, line)) != NULL){
+            if (line[0] == '>'){
+                printf("Replay %s: missing \"%s\"\n", r->name, line + 2);
+                r->failed = true;
+                break;
+            }
+        }
+    }
+    return !r->failed;
+}
+
+static int replay_run(const char *suite, FILE *record, int *scenarios)
+{
+    static replay_t r;          // too big for a task stack
+    int failed = 0;
+    int count = 0;
+
+    for (const char *block = replay_next_block(suite); *block != '\0'; block = r.block_end){
+        bool ok;
+
+        // leading comments are part of the suite, not a scenario
+        if (record != NULL && block == replay_next_block(suite) && block != suite){
+            fwrite(suite, 1, block - suite, record);
+        }
+        ok = replay_scenario(&r, block, record);
+        count++;
+        if (record == NULL){
+            printf("Replay %s: %s (%dms, %d outputs)\n", r.name, ok ? "ok" : "FAIL", r.now_ms, r.outputs);
+        }
+        if (!ok){
+            failed++;
+        }
+    }
+    if (scenarios != NULL){
+        *scenarios = count;
+    }
+    return failed;
+}
+
+int replay_check(const char *suite, int *scenarios)
+{
+    int count;
+    int failed = replay_run(suite, NULL, &count);
+
+    printf("Replay: %d/%d scenarios passed\n", count - failed, count);
+    if (scenarios != NULL){
+        *scenarios = count;
+    }
+    return failed;
+}
+
+void replay_record(const char *suite, FILE *out)
+{
+    replay_run(suite, out, NULL);
+}
@@ -0,0 +1,38 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+
+// Deterministic scenario replay: feeds scripted GPIO levels and ADC readings into the
+// production ignition state machine (vehicle.c) and wiper engine (wiper_engine.c) on a
+// virtual clock and compares their outputs with golden traces.
+//
+// A suite is plain text with one block per scenario:
+//
+//   scenario <name> [description]
+//   < <ms> <dseat|pseat|dbelt|pbelt|ignition> <GPIO level, 0 = pressed>
+//   < <ms> <wiper|int> <mV>
+//   < <ms> can <mode> <intermittence> | can release
+//   < <ms> fault <name> | fault none
+//   < <ms> stop <off|engine> <finish|park|freeze>
+//   < <ms> pulses <Hz>                      (simulated wheel speed pulse source)
+//   < <ms> intcurve <on|off>                (continuous INT delay from the knob curve)
+//   < <ms> end
+//   > <ms> led <ready|success|alarm> <level>
+//   > <ms> lcd <line> "<16 characters>"
+//   > <ms> print <console message>
+//   > <ms> duty <counts>
+//   > <ms> fade <target counts> <ms>
+//   > <ms> stop <counts>                      (fade cut short by a new wiper command)
+//
+// '<' lines are inputs in time order, '>' lines the expected outputs (only changes are
+// traced), lines starting with '#' are comments. Control passes run every 10ms of
+// virtual time, so a scenario of any length runs in a few milliseconds.
+
+// run every scenario and print a report, returns the number that failed
+int replay_check(const char *suite, int *scenarios);
+
+// run every scenario and write the suite to out with the expected outputs regenerated
+void replay_record(const char *suite, FILE *out);
+
+#endif
@@ -0,0 +1,136 @@
+#include "seat_watch.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#if CONFIG_WIPER_ULP_SEAT_WATCH
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "driver/rtc_io.h"
+#include "soc/rtc.h"
+#include "esp_private/esp_clk.h"
+#include "ulp_riscv.h"
+#include "ulp_common.h"
+#include "ulp_main.h"           // ulp_<name> for the variables of ulp/seat_watch_ulp.c
+
+extern const uint8_t ulp_main_bin_start[] asm("_binary_ulp_main_bin_start");
+extern const uint8_t ulp_main_bin_end[]   asm("_binary_ulp_main_bin_end");
+
+#define SEAT_BIT        (1 << 0)    // same as the ULP program
+#define IGNITION_BIT    (1 << 1)
+
+static RTC_DATA_ATTR uint64_t sleep_ticks;     // RTC timer when the main cores went to sleep, 0 after a power-on
+static uint64_t wake_ticks;                     // RTC timer when the ULP woke the main cores, 0 once reported
+static gpio_num_t pins[2];                      // driver seat, ignition
+static TickType_t empty_since;
+static bool empty_before;
+static bool failed;                             // the ULP couldn't be started, stay awake
+
+static uint32_t ticks_to_ms(uint64_t ticks)
+{
+    return (uint32_t)(rtc_time_slowclk_to_us(ticks, esp_clk_slowclk_cal_get()) / 1000);
+}
+
+void seat_watch_init(gpio_num_t dseat_pin, gpio_num_t ignition_pin)
+{
+    pins[0] = dseat_pin;
+    pins[1] = ignition_pin;
+    if (esp_reset_reason() != ESP_RST_DEEPSLEEP || sleep_ticks == 0){
+        return;
+    }
+
+    // the only wakeup source is the ULP, which keeps sampling until it is stopped
+    ulp_riscv_timer_stop();
+    wake_ticks = ((uint64_t)ulp_wake_time_hi << 32) | ulp_wake_time_lo;
+    uint32_t asleep_ms = ticks_to_ms(wake_ticks - sleep_ticks);
+    uint32_t busy_us = ulp_busy_cycles / ulp_cycles_per_us;
+    printf("Seat watch: woke by the %s after %" PRIu32 ".%" PRIu32 " s asleep, %" PRIu32 " ULP runs, %" PRIu32 " bounces.\n",
+           (ulp_changed & SEAT_BIT) ? "driver seat" : "ignition", asleep_ms / 1000, asleep_ms % 1000 / 100,
+           ulp_runs, ulp_bounces);
+    printf("Seat watch: ULP busy %" PRIu32 " us per run, %" PRIu32 " ppm of the time asleep; app_main %" PRIu32 " ms after the wakeup.\n",
+           ulp_runs ? busy_us / ulp_runs : 0, asleep_ms ? (uint32_t)((uint64_t)busy_us * 1000 / asleep_ms) : 0,
+           ticks_to_ms(rtc_time_get() - wake_ticks));
+    sleep_ticks = 0;
+}
+
+// hand the pins to the ULP and sleep, returns only if the ULP can't be started
+static void seat_watch_sleep(void)
+{
+    esp_err_t err = ulp_riscv_load_binary(ulp_main_bin_start, ulp_main_bin_end - ulp_main_bin_start);
+
+    for (int i = 0; i < 2 && err == ESP_OK; i++){
+        err = rtc_gpio_init(pins[i]);
+        if (err == ESP_OK){
+            err = rtc_gpio_set_direction(pins[i], RTC_GPIO_MODE_INPUT_ONLY);
+        }
+        if (err == ESP_OK){
+            err = rtc_gpio_pulldown_dis(pins[i]);
+        }
+        if (err == ESP_OK){
+            err = rtc_gpio_pullup_en(pins[i]);
+        }
+    }
+    if (err == ESP_OK){
+        ulp_dseat_gpio = pins[0];
+        ulp_ignition_gpio = pins[1];
+        ulp_debounce_runs = CONFIG_WIPER_ULP_DEBOUNCE;
+        ulp_inputs = 0;                         // the car is empty, both pins released
+        err = ulp_set_wakeup_period(0, CONFIG_WIPER_ULP_PERIOD_MS * 1000);
+    }
+    if (err == ESP_OK){
+        err = ulp_riscv_run();
+    }
+    if (err == ESP_OK){
+        err = esp_sleep_enable_ulp_wakeup();
+    }
+    if (err == ESP_OK){
+        err = esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);     // RTC pullups
+    }
+    if (err != ESP_OK){
+        printf("Seat watch: can't start the ULP (%s), staying awake.\n", esp_err_to_name(err));
+        ulp_riscv_timer_stop();
+        rtc_gpio_deinit(pins[0]);
+        rtc_gpio_deinit(pins[1]);
+        failed = true;
+        return;
+    }
+
+    printf("Seat watch: car empty for %d s, deep sleep until the driver seat or ignition is pressed.\n",
+           CONFIG_WIPER_SLEEP_IDLE_S);
+    fflush(stdout);
+    sleep_ticks = rtc_time_get();
+    esp_deep_sleep_start();
+}
+
+void seat_watch_idle(bool empty)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    // this is the first control pass after the wakeup, the one that shows the welcome message
+    if (wake_ticks != 0){
+        printf("Seat watch: first control pass %" PRIu32 " ms after the wakeup.\n", ticks_to_ms(rtc_time_get() - wake_ticks));
+        wake_ticks = 0;
+    }
+    if (!empty || failed){
+        empty_before = false;
+        return;
+    }
+    if (!empty_before){
+        empty_before = true;
+        empty_since = now;
+    }
+    else if (now - empty_since >= pdMS_TO_TICKS(CONFIG_WIPER_SLEEP_IDLE_S * 1000)){
+        seat_watch_sleep();
+    }
+}
+
+#else
+
+void seat_watch_init(gpio_num_t dseat_pin, gpio_num_t ignition_pin) {}
+void seat_watch_idle(bool empty) {}
+
+#endif
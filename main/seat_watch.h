@@ -0,0 +1,20 @@
+#ifndef SEAT_WATCH_H
+#define SEAT_WATCH_H
+
+#include <stdbool.h>
+#include "driver/gpio.h"
+
+// Deep sleep while nobody is in the car. Once the car has been empty for CONFIG_WIPER_SLEEP_IDLE_S
+// the control task hands the driver seat and ignition pins to the ULP coprocessor, which samples
+// them with its own debounce, and puts the main cores into deep sleep. The ULP wakes them only
+// when a pin changes and stays changed; the chip then boots as from power-on, and the welcome
+// message comes with the first control pass.
+
+// after a ULP wakeup stop the ULP and report the time asleep, the ULP duty and the wake latency,
+// then remember the pins for the next sleep (call before the pins are configured)
+void seat_watch_init(gpio_num_t dseat_pin, gpio_num_t ignition_pin);
+
+// call on every control pass, sleeps once the car has been empty for the idle time
+void seat_watch_idle(bool empty);
+
+#endif
@@ -0,0 +1,135 @@
+#include "servo_feedback.h"
+#include "freertos/FreeRTOS.h"
+#include <freertos/task.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if CONFIG_WIPER_SERVO_FEEDBACK
+
+#include "analog_in.h"
+#include "wiper_protect.h"
+
+// thresholds are fractions of the 90 degree span so they hold at any duty resolution
+#define FEEDBACK_TOLERANCE_DIV  (32)    // span / 32 (~3 degrees) counts as "at target"
+#define FEEDBACK_STALL_ERR_DIV  (10)    // tracking error of span / 10 (~9 degrees) before the arm is suspected stuck
+#define FEEDBACK_STALL_MOVE_DIV (128)   // movement per check below span / 128 still counts as stationary
+#define FEEDBACK_POLL_MS        (10)    // poll period while waiting at an endpoint
+
+static int duty_park;           // duty counts at 0 degrees
+static int duty_full;           // duty counts at 90 degrees
+static int tolerance;           // duty counts that count as "at target"
+static int stall_error;         // tracking error (duty counts) before the arm is suspected stuck
+static int stall_move;          // movement (duty counts) that still counts as stationary
+static int last_command;        // command the arm has been following since the last update
+static int last_position;       // position at the last update
+static int stall_ms;            // time the arm has been stuck away from its command
+static int max_error;           // largest tracking error since servo_feedback_max_error()
+static bool stalled;            // latched stall flag
+
+void servo_feedback_init(int park, int full)
+{
+    duty_park = park;
+    duty_full = full;
+    tolerance = (full - park) / FEEDBACK_TOLERANCE_DIV;
+    stall_error = (full - park) / FEEDBACK_STALL_ERR_DIV;
+    stall_move = (full - park) / FEEDBACK_STALL_MOVE_DIV;
+    last_command = park;
+    last_position = park;
+}
+
+int servo_feedback_position(void)
+{
+    int mv = analog_in_get_mv(ANALOG_SERVO_FEEDBACK);
+    return duty_park + (mv - CONFIG_WIPER_FEEDBACK_MV_PARK) * (duty_full - duty_park)
+                       / (CONFIG_WIPER_FEEDBACK_MV_FULL - CONFIG_WIPER_FEEDBACK_MV_PARK);
+}
+
+// compare the arm with the command it has had step_ms to follow, latch a stall if it stops short
+static void feedback_check(int step_ms)
+{
+    int position = servo_feedback_position();
+    int error = abs(last_command - position);
+
+    if (error > max_error){
+        max_error = error;
+    }
+
+    if (error > stall_error && abs(position - last_position) <= stall_move){
+        stall_ms += step_ms;
+    }
+    else{
+        stall_ms = 0;
+    }
+
+    if (!stalled && stall_ms >= CONFIG_WIPER_FEEDBACK_STALL_MS){
+        stalled = true;
+        printf("Wiper stall: commanded %d, arm at %d.\n", last_command, position);
+        wiper_protect_trip(WIPER_FAULT_STALL);
+    }
+
+    last_position = position;
+}
+
+void servo_feedback_track(int commanded, int step_ms)
+{
+    feedback_check(step_ms);
+    last_command = commanded;
+}
+
+int servo_feedback_settle(int target, int elapsed_ms, int half_period_ms)
+{
+    // give the arm until the half-period plus the stall window to reach the endpoint
+    while (wiper_protect_fault() == WIPER_FAULT_NONE &&
+           abs(servo_feedback_position() - target) > tolerance &&
+           elapsed_ms < half_period_ms + CONFIG_WIPER_FEEDBACK_STALL_MS){
+        vTaskDelay(pdMS_TO_TICKS(FEEDBACK_POLL_MS));
+        elapsed_ms += FEEDBACK_POLL_MS;
+        feedback_check(FEEDBACK_POLL_MS);
+    }
+    return elapsed_ms - half_period_ms;
+}
+
+bool servo_feedback_confirm_park(int park)
+{
+    last_command = park;
+    servo_feedback_settle(park, 0, 0);
+    return abs(servo_feedback_position() - park) <= tolerance;
+}
+
+int servo_feedback_max_error(void)
+{
+    int error = max_error;
+    max_error = 0;
+    return error;
+}
+
+void servo_feedback_print_stats(void)
+{
+    int error = servo_feedback_max_error();
+    printf("Wiper tracking error: worst %d counts (%d degrees).\n", error, error * 90 / (duty_full - duty_park));
+}
+
+bool servo_feedback_stalled(void)
+{
+    return stalled;
+}
+
+void servo_feedback_clear_stall(void)
+{
+    stalled = false;
+    stall_ms = 0;
+}
+
+#else
+
+void servo_feedback_init(int park, int full) {}
+int servo_feedback_position(void) { return 0; }
+void servo_feedback_track(int commanded, int step_ms) {}
+int servo_feedback_settle(int target, int elapsed_ms, int half_period_ms) { return 0; }
+bool servo_feedback_confirm_park(int park) { return true; }
+int servo_feedback_max_error(void) { return 0; }
+void servo_feedback_print_stats(void) {}
+bool servo_feedback_stalled(void) { return false; }
+void servo_feedback_clear_stall(void) {}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SERVO_FEEDBACK_H
+#define SERVO_FEEDBACK_H
+
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+// Closed-loop position feedback from the pot on the wiper shaft (CONFIG_WIPER_SERVO_FEEDBACK).
+// Positions are expressed in LEDC duty counts so they compare directly with the commanded duty.
+// With feedback disabled every call is a no-op that reports the arm as on target.
+
+// set the duty counts that correspond to CONFIG_WIPER_FEEDBACK_MV_PARK and _MV_FULL
+void servo_feedback_init(int duty_park, int duty_full);
+
+// measured arm position in duty counts
+int servo_feedback_position(void);
+
+// called before each LEDC fade segment: checks the arm against the previous command and watches for a stall
+void servo_feedback_track(int commanded, int step_ms);
+
+// wait (bounded) at a sweep endpoint for the arm to arrive, returns how late it was against half_period_ms
+int servo_feedback_settle(int target, int elapsed_ms, int half_period_ms);
+
+// hold at park until the arm is confirmed there, false if it never arrives
+bool servo_feedback_confirm_park(int park);
+
+// largest tracking error seen since the last call, in duty counts
+int servo_feedback_max_error(void);
+
+// print the largest tracking error of the drive and start the next one from zero
+void servo_feedback_print_stats(void);
+
+// stall flag, latched until cleared
+bool servo_feedback_stalled(void);
+void servo_feedback_clear_stall(void);
+
+#endif
@@ -0,0 +1,143 @@
+#include "telemetry.h"
+#include "freertos/FreeRTOS.h"
+#include <freertos/task.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#if CONFIG_WIPER_TELEMETRY
+
+#include "esp_timer.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "esp_http_server.h"
+#include "nvs_flash.h"
+#include "health.h"
+#include "wiper_protect.h"
+
+#define TELEMETRY_JSON_MAX      (768)   // response buffer, sized for every task in health_task_t
+#define TELEMETRY_PRIORITY      (tskIDLE_PRIORITY)  // below every control task, time-sliced with idle
+#define TELEMETRY_CORE          (1)     // app core, Wi-Fi and the ADC/LEDC/TWAI interrupts are on core 0
+
+static const char *engine_names[] = { "IDLE", "SEATED", "RUNNING", "OFF", "INHIBITED" };
+static const char *wiper_names[] = { "OFF", "INT", "LOW", "HIGH" };
+
+static char json[TELEMETRY_JSON_MAX];   // only the single HTTP server task writes it
+static telemetry_state_t published;     // latest state from the control task
+static portMUX_TYPE telemetry_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// GET /status: format the snapshot into the static buffer, nothing is allocated
+static esp_err_t status_get(httpd_req_t *req)
+{
+    telemetry_state_t state;
+    health_stats_t task;
+    int len;
+
+    portENTER_CRITICAL(&telemetry_lock);
+    state = published;
+    portEXIT_CRITICAL(&telemetry_lock);
+
+    len = snprintf(json, sizeof(json),
+                   "{\"uptime_s\":%" PRIu32 ",\"engine\":\"%s\",\"wiper\":\"%s\",\"int_delay_ms\":%u,"
+                   "\"fault\":\"%s\",\"tasks\":[",
+                   (uint32_t)(esp_timer_get_time() / 1000000),
+                   state.engine < sizeof(engine_names) / sizeof(engine_names[0]) ? engine_names[state.engine] : "?",
+                   wiper_names[state.wiper & 3], state.int_delay_ms, wiper_protect_fault_name(state.fault));
+
+    for (int id = 0; id < HEALTH_COUNT && len < (int)sizeof(json); id++){
+        if (!health_get_stats(id, &task)){
+            continue;
+        }
+        len += snprintf(json + len, sizeof(json) - len,
+                        "%s{\"name\":\"%s\",\"period_ms\":%" PRIu32 ",\"max_period_ms\":%" PRIu32 ","
+                        "\"stack_free\":%" PRIu32 ",\"missed\":%" PRIu32 ",\"restarts\":%" PRIu32 "}",
+                        json[len - 1] == '[' ? "" : ",", task.name, task.period_ms, task.max_period_ms,
+                        task.stack_free, task.missed, task.restarts);
+    }
+    if (len < (int)sizeof(json)){
+        len += snprintf(json + len, sizeof(json) - len, "]}");
+    }
+    if (len >= (int)sizeof(json)){
+        return httpd_resp_send_500(req);
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+static const httpd_uri_t status_uri = {
+    .uri = "/status",
+    .method = HTTP_GET,
+    .handler = status_get,
+};
+
+// keep the station connected and report the address it gets
+static void wifi_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (base == WIFI_EVENT && (id == WIFI_EVENT_STA_START || id == WIFI_EVENT_STA_DISCONNECTED)){
+        esp_wifi_connect();
+    }
+    else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP){
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)data;
+        printf("Telemetry: http://" IPSTR "/status\n", IP2STR(&event->ip_info.ip));
+    }
+}
+
+esp_err_t telemetry_init(void)
+{
+    wifi_init_config_t wifi_init = WIFI_INIT_CONFIG_DEFAULT();
+    wifi_config_t wifi_config = {
+        .sta = {
+            .ssid = CONFIG_WIPER_WIFI_SSID,
+            .password = CONFIG_WIPER_WIFI_PASSWORD,
+        },
+    };
+    httpd_config_t http_config = HTTPD_DEFAULT_CONFIG();
+    httpd_handle_t server = NULL;
+    esp_err_t err;
+
+    // Wi-Fi keeps its calibration data in NVS
+    err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND){
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    esp_netif_create_default_wifi_sta();
+    ESP_ERROR_CHECK(esp_wifi_init(&wifi_init));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_event, NULL));
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    // one small server task that never competes with the control tasks
+    http_config.server_port = CONFIG_WIPER_TELEMETRY_PORT;
+    http_config.task_priority = TELEMETRY_PRIORITY;
+    http_config.core_id = TELEMETRY_CORE;
+    http_config.max_open_sockets = 2;
+    http_config.max_uri_handlers = 1;
+    err = httpd_start(&server, &http_config);
+    if (err == ESP_OK){
+        err = httpd_register_uri_handler(server, &status_uri);
+    }
+    return err;
+}
+
+void telemetry_publish(const telemetry_state_t *state)
+{
+    portENTER_CRITICAL(&telemetry_lock);
+    published = *state;
+    portEXIT_CRITICAL(&telemetry_lock);
+}
+
+#else
+
+esp_err_t telemetry_init(void) { return ESP_OK; }
+void telemetry_publish(const telemetry_state_t *state) {}
+
+#endif
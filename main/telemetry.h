@@ -0,0 +1,26 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// Wi-Fi station and HTTP status endpoint for fleet monitoring (CONFIG_WIPER_TELEMETRY).
+// GET /status returns a JSON snapshot, the same document tools/telemetry_mock.py serves on a PC.
+// With telemetry disabled every call is a no-op.
+
+// state served on /status
+typedef struct {
+    uint8_t engine;             // ignition state machine value (executed)
+    uint8_t wiper;              // 0 OFF, 1 INT, 2 LOW, 3 HIGH
+    uint16_t int_delay_ms;      // intermittent dwell at 0 degrees
+    uint8_t fault;              // wiper_fault_t
+} telemetry_state_t;
+
+// join the configured Wi-Fi network and start the HTTP server
+esp_err_t telemetry_init(void);
+
+// hand the latest state to the endpoint
+void telemetry_publish(const telemetry_state_t *state);
+
+#endif
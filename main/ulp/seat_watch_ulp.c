@@ -0,0 +1,60 @@
+/* ULP RISC-V program for deep sleep with nobody in the car. The ULP timer starts it every
+CONFIG_WIPER_ULP_PERIOD_MS: it samples the driver seat and ignition pins, and wakes the
+main cores once a new level has held for debounce_runs samples in a row. Variables keep
+their values between runs, and the main cores see them as ulp_<name>. */
+#include <stdint.h>
+#include "ulp_riscv_utils.h"
+#include "ulp_riscv_gpio.h"
+#include "soc/rtc_cntl_reg.h"
+
+#define SEAT_BIT        (1 << 0)    // driver seat pressed
+#define IGNITION_BIT    (1 << 1)    // ignition pressed
+
+// set by the main cores before they sleep
+volatile uint32_t dseat_gpio;
+volatile uint32_t ignition_gpio;
+volatile uint32_t debounce_runs;    // equal samples before a new level counts
+volatile uint32_t inputs;           // levels the main cores went to sleep with, then the debounced levels
+
+// for the main cores after the wakeup
+volatile uint32_t changed;          // input bits that woke the main cores
+volatile uint32_t runs;             // ULP runs since the main cores slept
+volatile uint32_t bounces;          // new levels that didn't hold long enough
+volatile uint32_t busy_cycles;      // ULP cycles spent in main(), for the sleep current estimate
+volatile uint32_t cycles_per_us = ULP_RISCV_CYCLES_PER_US;
+volatile uint32_t wake_time_lo;     // RTC timer when the main cores were woken
+volatile uint32_t wake_time_hi;
+
+static uint32_t candidate;          // new levels being debounced
+static uint32_t held;               // samples they have held for
+
+int main(void)
+{
+    uint32_t start = ULP_RISCV_GET_CCOUNT();
+    uint32_t now = (ulp_riscv_gpio_get_level(dseat_gpio) == 0 ? SEAT_BIT : 0) |
+                   (ulp_riscv_gpio_get_level(ignition_gpio) == 0 ? IGNITION_BIT : 0);
+
+    runs++;
+    if (now == inputs){
+        if (held != 0){
+            bounces++;
+        }
+        held = 0;
+    }
+    else{
+        if (now != candidate){
+            candidate = now;
+            held = 0;
+        }
+        if (++held >= debounce_runs){
+            changed = now ^ inputs;
+            inputs = now;
+            SET_PERI_REG_MASK(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_UPDATE);
+            wake_time_lo = READ_PERI_REG(RTC_CNTL_TIME_LOW0_REG);
+            wake_time_hi = READ_PERI_REG(RTC_CNTL_TIME_HIGH0_REG);
+            ulp_riscv_wakeup_main_processor();
+        }
+    }
+    busy_cycles += ULP_RISCV_GET_CCOUNT() - start;
+    return 0;                       // halts until the next timer start
+}
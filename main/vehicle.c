@@ -0,0 +1,227 @@
+#include "vehicle.h"
+#include <stdio.h>
+#include <string.h>
+
+const int wiper_dwell_ms[4] = { 0, 1000, 3000, 5000 };
+
+#define INT_DELAY_MIN_MS    (500)       // ends of the continuous INT delay curve
+#define INT_DELAY_MAX_MS    (15000)
+
+// continuous INT delay: intermittence knob reading (mV) to dwell (ms), straight lines between the
+// points. Each segment multiplies the delay by about 1.5, so a bit of knob turn changes it by the
+// same proportion anywhere on the 0.5 to 15 s range. Clamped at both ends.
+static const struct { int mv; int ms; } int_delay_curve[] = {
+    {  100, INT_DELAY_MIN_MS }, {  460,   770 }, {  830,  1170 }, { 1190,  1790 }, { 1550,  2740 },
+    { 1910,  4190 }, { 2280,  6410 }, { 2640,  9810 }, { 3000, INT_DELAY_MAX_MS },
+};
+#define INT_CURVE_POINTS    ((int)(sizeof(int_delay_curve) / sizeof(int_delay_curve[0])))
+
+static const char *can_wiper_text[] = { "Wipers: OFF CAN", "Wipers: INT CAN", "Wipers: LOW CAN", "Wipers: HIGH CAN" };
+static const char *can_int_text[] = { "", "INT: SHORT", "INT: MED", "INT: LONG" };
+
+void vehicle_init(vehicle_t *v)
+{
+    memset(v, 0, sizeof(*v));
+}
+
+int vehicle_int_delay_ms(int mv)
+{
+    int i;
+
+    if (mv <= int_delay_curve[0].mv){
+        return int_delay_curve[0].ms;
+    }
+    for(i = 1; i < INT_CURVE_POINTS - 1 && mv > int_delay_curve[i].mv; i++){
+    }
+    if (mv >= int_delay_curve[i].mv){
+        return int_delay_curve[i].ms;
+    }
+    return int_delay_curve[i - 1].ms + (int_delay_curve[i].ms - int_delay_curve[i - 1].ms) *
+           (mv - int_delay_curve[i - 1].mv) / (int_delay_curve[i].mv - int_delay_curve[i - 1].mv);
+}
+
+int vehicle_speed_sample(vehicle_speed_t *speed, int pulses)
+{
+    int band = SERVO_SPEED_BANDS - 1;
+
+    speed->sum += pulses - speed->counts[speed->next];
+    speed->counts[speed->next] = pulses;
+    speed->next = (speed->next + 1) % SERVO_SPEED_WINDOW;
+
+    // highest band the pulses in the window reach
+    while (band > 0 && speed->sum < servo_speed_pulses[band]){
+        band--;
+    }
+    return band;
+}
+
+// set wipers according to the potentiometers (or a CAN bus command) and show them on the LCD
+static void vehicle_wipers(vehicle_t *v, const vehicle_inputs_t *in, const vehicle_io_t *io)
+{
+    const char *line1 = "Wipers: ";     // text for LCD line 1
+    const char *line2 = "";             // text for LCD line 2
+    char fault_text[17];                // "FAULT: <name>" for LCD line 2
+    char delay_text[17];                // "INT: <seconds> s" for LCD line 2
+
+    // a wiper command from the CAN bus overrides the knobs while it is fresh
+    if (in->can_wiper >= 0){
+        line1 = can_wiper_text[in->can_wiper];
+        line2 = in->can_wiper == 1 ? can_int_text[in->can_wiper_int] : "";
+        v->wiper = in->can_wiper;
+        v->wiper_int = in->can_wiper_int;
+    }
+
+    // if potentiometer set to off, write "wipers: off" on LCD, set wiper = 0
+    else if(in->wiper_mv < WIPER_POTENT_OFF){
+        line1 = "Wipers: OFF";
+        line2 = "          ";
+        v->wiper = 0;
+    }
+
+    // if potentiometer set to int, write "wipers: int" on LCD, set wiper = 1
+    else if(in->wiper_mv >= WIPER_POTENT_OFF && in->wiper_mv < WIPER_POTENT_LOW){
+        line1 = "Wipers: INT";
+        v->wiper = 1;
+        // if int short, write "int: short" on LCD, set wiper_int = 1
+        if (in->int_wiper_mv < WIPER_INT_SHORT){
+            line2 = "INT: SHORT";
+            v->wiper_int = 1;
+            }
+
+        // if int medium, write "int: med" on LCD, set wiper_int = 2
+        else if (in->int_wiper_mv >= WIPER_INT_SHORT && in->int_wiper_mv < WIPER_INT_LONG){
+            line2 = "INT: MED  ";
+            v->wiper_int = 2;
+            }
+
+        // if int long, write "int: long" on LCD, set wiper_int = 3
+        else if (in->int_wiper_mv >= WIPER_INT_LONG){
+            line2 = "INT: LONG  ";
+            v->wiper_int = 3;
+            }
+    }
+
+    // if wipers set to low, write "wipers: low" on LCD, set wiper = 2
+    else if(in->wiper_mv >= WIPER_POTENT_LOW && in->wiper_mv < WIPER_POTENT_HI){
+        line1 = "Wipers: LOW";
+        line2 = "          ";
+        v->wiper = 2;
+    }
+
+    // if wipers set to high, write "wipers: high" on LCD, set wiper = 3
+    else if(in->wiper_mv >= WIPER_POTENT_HI){
+        line1 = "Wipers: HIGH";
+        line2 = "          ";
+        v->wiper = 3;
+    }
+
+    // INT dwell: SHORT/MED/LONG, or with the continuous delay the knob curve shown in seconds
+    // (a CAN command still picks one of the three)
+    if (v->int_curve && in->can_wiper < 0){
+        unsigned delay_ms = vehicle_int_delay_ms(in->int_wiper_mv);
+
+        // the curve's own clamp, repeated so the compiler can see the text fits the line
+        delay_ms = delay_ms < INT_DELAY_MIN_MS ? INT_DELAY_MIN_MS : delay_ms > INT_DELAY_MAX_MS ? INT_DELAY_MAX_MS : delay_ms;
+        v->int_delay_ms = delay_ms;
+        if (v->wiper == 1){
+            snprintf(delay_text, sizeof(delay_text), "INT: %u.%u s", delay_ms / 1000, delay_ms % 1000 / 100);
+            line2 = delay_text;
+        }
+    }
+    else{
+        v->int_delay_ms = wiper_dwell_ms[v->wiper_int];
+    }
+
+    // a motor fault replaces line 2 until the knob is turned back to OFF
+    if (in->fault_name != NULL){
+        snprintf(fault_text, sizeof(fault_text), "FAULT: %s", in->fault_name);
+        line2 = fault_text;
+    }
+
+    io->lcd(io->ctx, 0, line1);
+    io->lcd(io->ctx, 1, line2);
+}
+
+void vehicle_step(vehicle_t *v, const vehicle_inputs_t *in, const vehicle_io_t *io)
+{
+    v->speed_band = in->speed_band;
+
+    // if the driver seat button is pressed, print the welcome message once
+    if (in->dseat){
+        if (v->executed == 0){      // if executed equals 0, print welcome message
+            io->print(io->ctx, "Welcome to enhanced alarm system model 218-W25 ");
+            v->executed = 1;        // set executed = 1 so welcome message only prints once
+        }
+    }
+
+    // if all of the conditions are met
+    if (in->dseat && in->pseat && in->dbelt && in->pbelt){
+        //set ready led to ON
+        if (v->executed == 1 && v->ready_led == 0){
+            io->set_output(io->ctx, VEHICLE_READY_LED, 1);
+            v->ready_led = 1;
+        }
+        // if ignition button is pressed while all conditions are met
+        if (in->ignition == true && v->executed == 1){
+            // turn on ignition LED and turn off ready LED
+            io->set_output(io->ctx, VEHICLE_SUCCESS_LED, 1);
+            io->set_output(io->ctx, VEHICLE_READY_LED, 0);
+            io->set_output(io->ctx, VEHICLE_ALARM, VEHICLE_ALARM_START);
+            // print engine started message once
+            io->print(io->ctx, "Engine started!");
+            v->executed = 2;        // set executed = 2 so engine started message only prints once
+        }
+    }
+
+    // otherwise (at least one condition is not satisfied)
+    else{
+        // set ready LED to OFF and set variable ready_led to 0
+        io->set_output(io->ctx, VEHICLE_READY_LED, 0);
+        v->ready_led = 0;
+        // if ignition button is pressed while conditions are not satisfied
+        if (in->ignition == true && v->executed < 2){
+                // turn on alarm buzzer, chirping for an empty seat, a steady tone if only belts are missing
+                io->set_output(io->ctx, VEHICLE_ALARM, in->dseat && in->pseat ? VEHICLE_ALARM_BELT : VEHICLE_ALARM_CHIRP);
+                io->print(io->ctx, "Ignition inhibited.");
+                // check which conditions are not met, print corresponding message
+                if (!in->pseat){
+                    io->print(io->ctx, "Passenger seat not occupied.");
+                }
+                if (!in->dseat){
+                    io->print(io->ctx, "Driver seat not occupied.");
+                }
+                if (!in->pbelt){
+                    io->print(io->ctx, "Passenger seatbelt not fastened.");
+                }
+                if (!in->dbelt){
+                    io->print(io->ctx, "Drivers seatbelt not fastened.");
+                }
+                v->executed = 4;    // set executed = 4 so messages print only once
+
+        }
+    }
+
+    // if executed = 4 (failed ignition) and ignition button is released
+    if (in->ignition == false && v->executed == 4){
+        // reset to state after welcome message, testing for conditions
+        v->executed = 1;
+    }
+
+    // if iginition successful, set wipers according to potentiometers
+    if (v->executed == 2){
+        vehicle_wipers(v, in, io);
+    }
+
+    // if ignition is successfully started and then ignition is released, set ignition_off = 1
+    if (v->executed == 2 && in->ignition == false){
+        v->ignition_off = 1;
+    }
+
+    // if ignition_off = 1 and inition is pressed, turn off all LEDs
+    if (v->ignition_off == 1 && in->ignition == true){
+        io->set_output(io->ctx, VEHICLE_SUCCESS_LED, 0);    // turn off ignition
+        io->lcd(io->ctx, 0, "");                            // turn off wiper lcd
+        io->lcd(io->ctx, 1, "");
+        v->executed = 3;                                    // set executed = 3 to keep LEDs off, exit wiper task loop
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef VEHICLE_H
+#define VEHICLE_H
+
+#include <stdbool.h>
+#include "servo_table.h"
+
+// Ignition state machine and wiper knob decoding, one call per 10ms control pass.
+// Plain C with every input passed in and every output going through vehicle_io_t,
+// so the control task and the replay engine (replay.c) run exactly the same logic.
+
+#define WIPER_POTENT_OFF    (500)       // adcmV level for wipers off
+#define WIPER_POTENT_LOW    (1570)      // adcmV level for wipers low
+#define WIPER_POTENT_HI     (2650)      // adcmV level for wipers high
+#define WIPER_INT_SHORT     (910)       // adcmV level for intermittence short
+#define WIPER_INT_LONG      (1960)      // adcmV level for intermittence long
+
+#define VEHICLE_CONTROL_MS  (10)        // control pass period
+
+// indicator outputs
+typedef enum {
+    VEHICLE_READY_LED = 0,      // ignition enabled (green)
+    VEHICLE_SUCCESS_LED,        // engine running (red)
+    VEHICLE_ALARM,              // buzzer, level is a VEHICLE_ALARM_* pattern
+    VEHICLE_OUTPUT_COUNT
+} vehicle_output_t;
+
+// VEHICLE_ALARM levels, each one a buzzer pattern
+#define VEHICLE_ALARM_OFF   (0)
+#define VEHICLE_ALARM_CHIRP (1)         // ignition inhibited by an empty seat
+#define VEHICLE_ALARM_BELT  (2)         // ignition inhibited by unfastened belts only
+#define VEHICLE_ALARM_START (3)         // engine started, a single beep
+
+// inputs sampled for one control pass
+typedef struct {
+    bool dseat;                 // driver seated
+    bool pseat;                 // passenger seated
+    bool dbelt;                 // driver seatbelt on
+    bool pbelt;                 // passenger seatbelt on
+    bool ignition;              // ignition button pressed
+    int wiper_mv;               // wiper potentiometer (mV)
+    int int_wiper_mv;           // intermittence potentiometer (mV)
+    int can_wiper;              // wiper mode commanded on the CAN bus, -1 for none
+    int can_wiper_int;          // intermittence commanded on the CAN bus
+    const char *fault_name;     // wiper motor fault, NULL while the motor may run
+    int speed_band;             // wheel speed band from vehicle_speed_sample(), 0 at standstill
+} vehicle_inputs_t;
+
+// where the outputs of a control pass go
+typedef struct {
+    void *ctx;
+    void (*set_output)(void *ctx, vehicle_output_t output, int level);
+    void (*lcd)(void *ctx, int line, const char *text);     // text is padded to 16 characters by the callee
+    void (*print)(void *ctx, const char *text);             // one console message, no newline
+} vehicle_io_t;
+
+typedef struct {
+    int executed;               // 0 waiting, 1 seated, 2 engine running, 3 engine off, 4 ignition inhibited
+    int ready_led;              // ready LED on
+    int ignition_off;           // ignition released since the engine started
+    int wiper;                  // 0 OFF, 1 INT, 2 LOW, 3 HIGH
+    int wiper_int;              // 1 SHORT, 2 MED, 3 LONG
+    int speed_band;             // index into the servo_speed_* tables
+    bool int_curve;             // INT delay from the knob curve instead of SHORT/MED/LONG
+    int int_delay_ms;           // INT dwell at standstill, follows the knob every control pass
+} vehicle_t;
+
+// wheel pulse counts of the last SERVO_SPEED_WINDOW sample periods
+typedef struct {
+    int counts[SERVO_SPEED_WINDOW];
+    int next;
+    int sum;
+} vehicle_speed_t;
+
+// INT dwell for each wiper_int setting
+extern const int wiper_dwell_ms[4];
+
+// continuous INT dwell for an intermittence knob reading, 0.5 to 15 s
+int vehicle_int_delay_ms(int mv);
+
+// add the pulses counted in one SERVO_SPEED_SAMPLE_MS period, returns the speed band
+int vehicle_speed_sample(vehicle_speed_t *speed, int pulses);
+
+// power-on state
+void vehicle_init(vehicle_t *v);
+
+// run one control pass
+void vehicle_step(vehicle_t *v, const vehicle_inputs_t *in, const vehicle_io_t *io);
+
+#endif
@@ -0,0 +1,113 @@
+#include "warm_start.h"
+#include <stddef.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "esp_rtc_time.h"
+#include "servo_table.h"
+#include "sdkconfig.h"
+
+#if CONFIG_WIPER_WARM_START
+
+#define WARM_MAGIC      (0x57495045)    // "WIPE"
+
+typedef struct {
+    uint32_t magic;
+    warm_state_t state;
+    uint32_t crc;               // over everything before it
+} warm_snapshot_t;
+
+static RTC_NOINIT_ATTR warm_snapshot_t snapshot;
+static portMUX_TYPE snapshot_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t snapshot_crc(void)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)&snapshot, offsetof(warm_snapshot_t, crc));
+}
+
+bool warm_start_restore(warm_state_t *state)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool valid = snapshot.magic == WARM_MAGIC && snapshot.crc == snapshot_crc();
+    bool crashed = reason == ESP_RST_BROWNOUT || reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+                   reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT;
+
+    if (valid){
+        *state = snapshot.state;
+    }
+    // start a new snapshot of this drive either way (a power-on leaves RTC memory random)
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.magic = WARM_MAGIC;
+    if (valid && crashed){
+        snapshot.state = *state;
+    }
+    snapshot.crc = snapshot_crc();
+    return valid && crashed;
+}
+
+int warm_start_duty(const warm_state_t *state)
+{
+    // the reset happened about as long ago as this boot has been running
+    int64_t reset_us = (int64_t)esp_rtc_get_time_us() - esp_timer_get_time();
+    int64_t elapsed_ms = (reset_us - (int64_t)state->fade_start_us) / 1000;
+    int delta = (int)state->duty_to - (int)state->duty_from;
+    int duty;
+
+    if (state->duty_to == 0){
+        return SERVO_DUTY_PARK;     // reset before the first servo save, 0 is never a servo duty
+    }
+    if (state->fade_ms == 0 || elapsed_ms >= state->fade_ms){
+        duty = state->duty_to;
+    }
+    else if (elapsed_ms <= 0){
+        duty = state->duty_from;    // RTC timer restarted, the fade can't have got far
+    }
+    else{
+        duty = state->duty_from + (int)(delta * elapsed_ms / state->fade_ms);
+    }
+    // keep the arm inside its sweep whatever the snapshot says
+    if (duty < SERVO_DUTY_PARK){
+        duty = SERVO_DUTY_PARK;
+    }
+    if (duty > SERVO_DUTY_FULL){
+        duty = SERVO_DUTY_FULL;
+    }
+    return duty;
+}
+
+void warm_start_save_vehicle(int engine, int wiper, int wiper_int)
+{
+    portENTER_CRITICAL(&snapshot_lock);
+    snapshot.state.engine = engine;
+    snapshot.state.wiper = wiper;
+    snapshot.state.wiper_int = wiper_int;
+    snapshot.crc = snapshot_crc();
+    portEXIT_CRITICAL(&snapshot_lock);
+}
+
+void warm_start_save_servo(int duty_from, int duty_to, int fade_ms)
+{
+    uint64_t now_us = esp_rtc_get_time_us();
+
+    portENTER_CRITICAL(&snapshot_lock);
+    if (fade_ms != 0 || snapshot.state.fade_ms != 0 || snapshot.state.duty_to != duty_to){
+        snapshot.state.duty_from = duty_from;
+        snapshot.state.duty_to = duty_to;
+        snapshot.state.fade_ms = fade_ms;
+        snapshot.state.fade_start_us = now_us;
+        snapshot.crc = snapshot_crc();
+    }
+    portEXIT_CRITICAL(&snapshot_lock);
+}
+
+#else
+
+bool warm_start_restore(warm_state_t *state) { return false; }
+int warm_start_duty(const warm_state_t *state) { return state->duty_to; }
+void warm_start_save_vehicle(int engine, int wiper, int wiper_int) {}
+void warm_start_save_servo(int duty_from, int duty_to, int fade_ms) {}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef WARM_START_H
+#define WARM_START_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// A CRC-protected snapshot of the drive in RTC slow memory, which keeps its contents through
+// every reset but a power-on. The control task saves the engine state and wiper setting when
+// they change, the wiper task saves each servo fade as it starts and stops. After a brownout,
+// watchdog or panic reset app_main restores the engine and wiper setting and starts the servo
+// at the angle the arm had reached instead of at 0 degrees.
+
+typedef struct {
+    uint8_t engine;             // vehicle_t executed
+    uint8_t wiper;              // 0 OFF, 1 INT, 2 LOW, 3 HIGH
+    uint8_t wiper_int;          // 1 SHORT, 2 MED, 3 LONG
+    uint16_t duty_from;         // servo fade in progress, from == to while the arm holds
+    uint16_t duty_to;
+    uint32_t fade_ms;
+    uint64_t fade_start_us;     // RTC timer, which keeps counting through a reset
+} warm_state_t;
+
+// copy the snapshot if the last reset interrupted a drive and the snapshot is intact
+bool warm_start_restore(warm_state_t *state);
+
+// servo duty the arm had reached when the reset hit (to within the bootloader's run time)
+int warm_start_duty(const warm_state_t *state);
+
+// record the engine state and wiper setting (control task)
+void warm_start_save_vehicle(int engine, int wiper, int wiper_int);
+
+// record a servo fade from one duty to another, fade_ms 0 for a duty held (wiper task)
+void warm_start_save_servo(int duty_from, int duty_to, int fade_ms);
+
+#endif
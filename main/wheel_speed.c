@@ -0,0 +1,97 @@
+#include "wheel_speed.h"
+#include <stdint.h>
+#include "vehicle.h"
+
+#if CONFIG_WIPER_WHEEL_SPEED
+
+#include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
+#include "esp_timer.h"
+
+#define SPEED_HIGH_LIMIT    (30000)     // the counter wraps here into the accumulated count
+#define SPEED_GLITCH_NS     (1000)      // pulses shorter than this are noise
+
+static pcnt_unit_handle_t unit;
+static esp_timer_handle_t sample_timer;
+static vehicle_speed_t speed;           // only the sample timer touches it
+static int last_count;
+static volatile int band;
+
+// fixed-rate speed update from the esp_timer task
+static void wheel_speed_sample(void *arg)
+{
+    int count;
+
+    if (pcnt_unit_get_count(unit, &count) == ESP_OK){
+        band = vehicle_speed_sample(&speed, (int)((uint32_t)count - (uint32_t)last_count));
+        last_count = count;
+    }
+}
+
+esp_err_t wheel_speed_init(void)
+{
+    pcnt_unit_config_t unit_config = {
+        .low_limit = -1,                // never reached, the count only goes up
+        .high_limit = SPEED_HIGH_LIMIT,
+        .flags.accum_count = 1,
+    };
+    pcnt_chan_config_t chan_config = {
+        .edge_gpio_num = CONFIG_WIPER_SPEED_GPIO,
+        .level_gpio_num = -1,
+    };
+    pcnt_glitch_filter_config_t filter_config = {
+        .max_glitch_ns = SPEED_GLITCH_NS,
+    };
+    esp_timer_create_args_t timer_args = {
+        .callback = wheel_speed_sample,
+        .name = "wheel_speed",
+    };
+    pcnt_channel_handle_t channel;
+    esp_err_t err;
+
+    err = pcnt_new_unit(&unit_config, &unit);
+    if (err == ESP_OK){
+        err = pcnt_unit_set_glitch_filter(unit, &filter_config);
+    }
+    if (err == ESP_OK){
+        err = pcnt_new_channel(unit, &chan_config, &channel);
+    }
+    if (err == ESP_OK){
+        // count rising edges, an open collector sensor pulls the line low between them
+        err = pcnt_channel_set_edge_action(channel, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD);
+    }
+    if (err == ESP_OK){
+        err = gpio_pullup_en(CONFIG_WIPER_SPEED_GPIO);
+    }
+    if (err == ESP_OK){
+        err = pcnt_unit_add_watch_point(unit, SPEED_HIGH_LIMIT);     // needed for the accumulated count
+    }
+    if (err == ESP_OK){
+        err = pcnt_unit_enable(unit);
+    }
+    if (err == ESP_OK){
+        err = pcnt_unit_clear_count(unit);
+    }
+    if (err == ESP_OK){
+        err = pcnt_unit_start(unit);
+    }
+    if (err == ESP_OK){
+        err = esp_timer_create(&timer_args, &sample_timer);
+    }
+    if (err == ESP_OK){
+        err = esp_timer_start_periodic(sample_timer, SERVO_SPEED_SAMPLE_MS * 1000);
+    }
+    return err;
+}
+
+int wheel_speed_band(void)
+{
+    return band;
+}
+
+#else
+
+esp_err_t wheel_speed_init(void) { return ESP_OK; }
+int wheel_speed_band(void) { return 0; }
+
+#endif
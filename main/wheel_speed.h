@@ -0,0 +1,19 @@
+#ifndef WHEEL_SPEED_H
+#define WHEEL_SPEED_H
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// Vehicle speed from the wheel speed pulse line (CONFIG_WIPER_WHEEL_SPEED). The PCNT peripheral
+// counts the pulses in hardware, so there is no interrupt per pulse, only one each time the
+// counter wraps into its accumulated count. An esp_timer reads the count every
+// SERVO_SPEED_SAMPLE_MS and turns the window of counts into a speed band through the
+// generated tables (vehicle_speed_sample()). Without the option the band is always 0.
+
+// set up the pulse counter and start sampling
+esp_err_t wheel_speed_init(void);
+
+// speed band of the last sample, index into the servo_speed_* tables
+int wheel_speed_band(void);
+
+#endif
@@ -0,0 +1,278 @@
+#include "wiper_engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void servo_fade_plan(int delta, int periods, servo_fade_t fade[2])
+{
+    if (delta >= periods){      // one or more counts every period
+        fade[0] = (servo_fade_t){ .scale = delta / periods + 1, .cycle_num = 1, .steps = delta % periods };
+        fade[1] = (servo_fade_t){ .scale = delta / periods, .cycle_num = 1, .steps = periods - delta % periods };
+    }
+    else{                       // one count every few periods
+        fade[0] = (servo_fade_t){ .scale = 1, .cycle_num = periods / delta + 1, .steps = periods % delta };
+        fade[1] = (servo_fade_t){ .scale = 1, .cycle_num = periods / delta, .steps = delta - periods % delta };
+    }
+}
+
+// move the arm from where it is to target at the profile's speed, false if the engine was stopped.
+// A full half-sweep keeps the generated fade plan and the feedback lead; a move that starts partway
+// (after a mode change or a stop) gets a plan for the distance left in the same share of the
+// half-period. Returns with engine->duty short of target when a new command cut a fade short.
+static bool wiper_move(wiper_engine_t *engine, const wiper_io_t *io, const servo_profile_t *profile,
+                       int target, int *lead_ms)
+{
+    servo_fade_t plan[2];
+    const servo_fade_t *fade = profile->fade;
+    const int range = SERVO_DUTY_FULL - SERVO_DUTY_PARK;
+    bool outward = target > engine->duty;
+    int delta = abs(target - engine->duty);
+    bool full = delta == range;
+    int used_lead_ms = full ? *lead_ms : 0;
+    int move_ms = profile->half_period_ms * delta / range;
+    int duty = engine->duty;
+    int since_ms = 0;                                   // time since the last feedback check
+    int start = io->now_ms(io->ctx);
+    int i;
+
+    if (delta == 0){
+        return true;
+    }
+
+    // finish the command early by the servo's measured lag
+    if (used_lead_ms > 0){
+        servo_fade_plan(range, (profile->half_period_ms - used_lead_ms) * SERVO_FREQUENCY_HZ / 1000, plan);
+        fade = plan;
+    }
+    else if (!full){
+        int periods = move_ms * SERVO_FREQUENCY_HZ / 1000;
+        servo_fade_plan(delta, periods > 0 ? periods : 1, plan);
+        fade = plan;
+    }
+
+    for(i = 0; i < 2; i++){
+        const servo_fade_t *segment = &fade[outward ? i : 1 - i];  // mirror the segments on the way back
+        if (segment->steps == 0){
+            continue;
+        }
+        if (io->faulted(io->ctx)){
+            return true;                                // output was cut, leave it off
+        }
+        int segment_ms = segment->steps * segment->cycle_num * 1000 / SERVO_FREQUENCY_HZ;
+        duty += (outward ? 1 : -1) * segment->scale * segment->steps;
+
+        io->track(io->ctx, duty, since_ms);             // check the arm kept up with the last segment
+        if (!io->fade(io->ctx, duty, segment, segment_ms)){
+            return false;
+        }
+        engine->wakeups++;
+        engine->duty = io->fade_stop(io->ctx);
+        if (engine->duty != duty){
+            return true;                                // new command, the caller carries on from here
+        }
+        since_ms = segment_ms;
+    }
+
+    // wait for the arm to reach the endpoint and, after a full sweep, move the lead toward its lateness
+    int late_ms = io->settle(io->ctx, target, io->now_ms(io->ctx) - start, move_ms);
+    if (full){
+        *lead_ms += late_ms / 2;
+        if (*lead_ms < 0){
+            *lead_ms = 0;
+        }
+        else if (*lead_ms > profile->half_period_ms / 2){
+            *lead_ms = profile->half_period_ms / 2;
+        }
+    }
+
+    // a shortened ramp ends early: hold until the half-period is over
+    if (used_lead_ms > 0){
+        int hold_ms = start + profile->half_period_ms - io->now_ms(io->ctx);
+        if (hold_ms > 0 && !io->wait_ms(io->ctx, hold_ms)){
+            return false;
+        }
+        engine->wakeups++;
+    }
+    return true;
+}
+
+// back at 0 degrees: report servo steps and wakeups the first time a speed runs
+static void wiper_cycle_done(wiper_engine_t *engine, const wiper_io_t *io)
+{
+    char text[64];
+    int steps = 0;
+    int i;
+
+    if (engine->mode != NULL && engine->mode != engine->last_mode){
+        for(i = 0; i < 2; i++){
+            steps += 2 * engine->profile->fade[i].steps;    // out and back
+        }
+        snprintf(text, sizeof(text), "Wipers %s: %d servo steps, %d CPU wakeups per sweep.",
+                 engine->mode, steps, engine->wakeups);
+        io->print(io->ctx, text);
+        engine->last_mode = engine->mode;
+    }
+    engine->wakeups = 0;
+}
+
+// carry on with the half-sweep in progress, turning around at 90 degrees, false if the engine was stopped
+static bool wiper_half(wiper_engine_t *engine, const wiper_io_t *io, const servo_profile_t *profile)
+{
+    int target = engine->outward ? SERVO_DUTY_FULL : SERVO_DUTY_PARK;
+    bool high = profile >= servo_speed_high && profile < servo_speed_high + SERVO_SPEED_BANDS;
+    int *lead_ms = high ? &engine->lead_high_ms : &engine->lead_low_ms;   // one lead for all bands of a speed
+
+    if (!wiper_move(engine, io, profile, target, lead_ms)){
+        return false;
+    }
+    if (engine->duty == target){
+        engine->outward = !engine->outward;
+        if (target == SERVO_DUTY_PARK){
+            wiper_cycle_done(engine, io);
+        }
+    }
+    return true;
+}
+
+// the arm reached 0 degrees after a stop command: report how long it took
+static void wiper_parked(wiper_engine_t *engine, const wiper_io_t *io)
+{
+    char text[64];
+
+    if (engine->stop_ms < 0){
+        return;
+    }
+    int park_ms = io->now_ms(io->ctx) - engine->stop_ms;
+    if (park_ms > engine->park_worst_ms){
+        engine->park_worst_ms = park_ms;
+    }
+    snprintf(text, sizeof(text), "Wiper parked %d ms after the stop command (worst %d ms).",
+             park_ms, engine->park_worst_ms);
+    io->print(io->ctx, text);
+    engine->stop_ms = -1;
+}
+
+// intermittent dwell at 0 degrees, over when INT is left. The delay is looked up again each time
+// the task wakes, so a knob turn or a speed change moves the end of the dwell already running;
+// the waits are split up so the wiper task keeps beating
+static bool wiper_dwell(const vehicle_t *v, const wiper_io_t *io)
+{
+    int start = io->now_ms(io->ctx);
+
+    while (v->wiper == 1 && v->executed != 3){
+        int left = start + v->int_delay_ms * servo_speed_dwell_pct[v->speed_band] / 100 - io->now_ms(io->ctx);
+        if (left <= 0){
+            break;
+        }
+        if (!io->wait_change(io->ctx, left < 100 ? left : 100)){
+            return false;
+        }
+    }
+    return true;
+}
+
+void wiper_engine_set_stop(wiper_engine_t *engine, wiper_stop_t off_stop, wiper_stop_t engine_off_stop)
+{
+    engine->off_stop = off_stop;
+    engine->engine_off_stop = engine_off_stop;
+}
+
+void wiper_engine_resume_at(wiper_engine_t *engine, int duty, bool outward)
+{
+    engine->resume_duty = duty;
+    engine->resume_outward = outward;
+}
+
+void wiper_engine_run(wiper_engine_t *engine, const vehicle_t *v, const wiper_io_t *io)
+{
+    wiper_stop_t off_stop = engine->off_stop;
+    wiper_stop_t engine_off_stop = engine->engine_off_stop;
+    int resume_duty = engine->resume_duty;
+    bool resume_outward = engine->resume_outward;
+    bool running = true;
+
+    // the servo is parked before the engine starts (by app_main, or the health supervisor on a restart),
+    // unless a warm start left it where the reset found it (only for the first run)
+    memset(engine, 0, sizeof(*engine));
+    wiper_engine_set_stop(engine, off_stop, engine_off_stop);
+    engine->duty = resume_duty != 0 ? resume_duty : SERVO_DUTY_PARK;
+    engine->outward = resume_duty != 0 ? resume_outward : true;
+    engine->stop_ms = -1;
+
+    while(running){
+        bool engine_off = v->executed == 3;
+
+        // after a motor fault keep the output cut until the knob is turned to OFF
+        if (io->faulted(io->ctx)){
+            if (engine_off){
+                break;
+            }
+            if (v->wiper == 0){
+                io->clear_fault(io->ctx);
+                engine->duty = SERVO_DUTY_PARK;         // parked again right below
+                engine->outward = true;
+            }
+            running = io->wait_ms(io->ctx, 10);
+        }
+
+        // OFF or engine off: follow the stop policy until the arm is parked (or frozen)
+        else if (engine_off || v->wiper == 0){
+            wiper_stop_t stop = engine_off ? engine->engine_off_stop : engine->off_stop;
+
+            if (!engine->stopping){
+                engine->stopping = true;
+                engine->stop_ms = engine->duty == SERVO_DUTY_PARK ? -1 : io->now_ms(io->ctx);
+            }
+
+            // make motor stationary at minimum angle
+            if (engine->duty == SERVO_DUTY_PARK){
+                wiper_parked(engine, io);
+                if (engine_off){
+                    break;
+                }
+                io->set_duty(io->ctx, SERVO_DUTY_PARK);
+                running = io->wait_ms(io->ctx, 10);
+            }
+            else if (stop == WIPER_STOP_FREEZE){
+                if (engine_off){
+                    break;
+                }
+                running = io->wait_ms(io->ctx, 10);
+            }
+            else if (stop == WIPER_STOP_PARK){
+                engine->outward = false;
+                running = wiper_half(engine, io, &servo_speed_high[v->speed_band]);
+            }
+            else{
+                running = wiper_half(engine, io, engine->profile != NULL ? engine->profile : &servo_speed_low[v->speed_band]);
+            }
+        }
+
+        // INT and LOW rotate to 90 degrees and back at low speed (3s period), HIGH at high speed (1.2s period),
+        // carrying on from wherever the arm is; each half-sweep takes the plan for the current wheel speed
+        else{
+            bool closing = !engine->outward;
+
+            engine->stopping = false;
+            engine->stop_ms = -1;
+            engine->mode = v->wiper == 3 ? "HIGH" : v->wiper == 2 ? "LOW" : "INT";
+            engine->profile = v->wiper == 3 ? &servo_speed_high[v->speed_band] : &servo_speed_low[v->speed_band];
+            running = wiper_half(engine, io, engine->profile);
+
+            // INT pauses at 0 degrees after each cycle for 1 (SHORT), 3 (MED) or 5 (LONG) seconds, or the
+            // continuous delay, less when moving
+            if (running && closing && engine->duty == SERVO_DUTY_PARK && v->wiper == 1){
+                running = wiper_dwell(v, io);
+            }
+        }
+    }
+
+    // engine off: hold the arm at 0 degrees and make sure it really parked (unless the motor was cut
+    // or the arm was frozen)
+    if (running && !io->faulted(io->ctx) && engine->duty == SERVO_DUTY_PARK){
+        io->set_duty(io->ctx, SERVO_DUTY_PARK);
+        if (!io->park_confirmed(io->ctx)){
+            io->print(io->ctx, "Wiper park not confirmed.");
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef WIPER_ENGINE_H
+#define WIPER_ENGINE_H
+
+#include <stdbool.h>
+#include "servo_table.h"
+#include "vehicle.h"
+
+// Wiper sweep sequencing driven by the vehicle state, with every servo write and wait
+// going through wiper_io_t. The wiper task runs it on the LEDC fade engine, the replay
+// engine (replay.c) runs it against a virtual clock.
+
+typedef struct {
+    void *ctx;
+    void (*set_duty)(void *ctx, int duty);
+    // run one fade segment ending at duty, returns once it is done or the wiper setting or
+    // engine state changed (false stops the engine)
+    bool (*fade)(void *ctx, int duty, const servo_fade_t *segment, int segment_ms);
+    int (*fade_stop)(void *ctx);                            // stop the fade, returns the duty the arm got to
+    bool (*wait_ms)(void *ctx, int ms);                     // false stops the engine
+    // like wait_ms, but returns early when the wiper setting, engine state or INT delay changes
+    bool (*wait_change)(void *ctx, int ms);
+    int (*now_ms)(void *ctx);
+    bool (*faulted)(void *ctx);                             // motor output cut by the protection
+    void (*clear_fault)(void *ctx);                         // knob back at OFF after a fault
+    void (*track)(void *ctx, int duty, int since_ms);       // see servo_feedback_track()
+    int (*settle)(void *ctx, int target, int elapsed_ms, int half_period_ms);  // see servo_feedback_settle()
+    bool (*park_confirmed)(void *ctx);
+    void (*print)(void *ctx, const char *text);             // one console message, no newline
+} wiper_io_t;
+
+// what the arm does when the wiper is turned OFF or the engine is turned off mid-sweep
+typedef enum {
+    WIPER_STOP_FINISH = 0,      // complete the out-and-back cycle, then park (specifications 12 and 13)
+    WIPER_STOP_PARK,            // turn back from where the arm is and park at HIGH speed
+    WIPER_STOP_FREEZE,          // hold the arm where it is
+} wiper_stop_t;
+
+typedef struct {
+    wiper_stop_t off_stop;      // policy for the knob at OFF
+    wiper_stop_t engine_off_stop;   // policy for the engine turned off
+    int lead_low_ms;            // ramp compression at LOW/INT speed
+    int lead_high_ms;           // ramp compression at HIGH speed
+    int wakeups;                // engine wakeups during the current sweep
+    const char *last_mode;      // last speed reported
+    const char *mode;           // speed of the cycle in progress
+    const servo_profile_t *profile;
+    int duty;                   // where the arm was last commanded to
+    bool outward;               // next or current half-sweep goes toward 90 degrees
+    bool stopping;              // OFF or engine off seen and not yet resumed
+    int stop_ms;                // time of the stop command, -1 once parked or if it found the arm parked
+    int park_worst_ms;          // longest stop command to park time
+    int resume_duty;            // arm position for the next run instead of parked, 0 for none
+    bool resume_outward;
+} wiper_engine_t;
+
+// split a duty change over a number of PWM periods into two fade segments (as gen_servo_table.py does)
+void servo_fade_plan(int delta, int periods, servo_fade_t fade[2]);
+
+// choose the stop policies, also while the engine runs (a stop in progress follows the change)
+void wiper_engine_set_stop(wiper_engine_t *engine, wiper_stop_t off_stop, wiper_stop_t engine_off_stop);
+
+// start the next wiper_engine_run() from an arm left away from 0 degrees (after a warm start)
+void wiper_engine_resume_at(wiper_engine_t *engine, int duty, bool outward);
+
+// sweep according to v->wiper until the engine is turned off, then park (the stop policies are kept)
+void wiper_engine_run(wiper_engine_t *engine, const vehicle_t *v, const wiper_io_t *io);
+
+#endif
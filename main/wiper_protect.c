@@ -0,0 +1,135 @@
+#include "wiper_protect.h"
+#include "freertos/FreeRTOS.h"
+#include <freertos/task.h>
+#include <stdio.h>
+#include "esp_attr.h"
+#include "analog_in.h"
+#include "event_log.h"
+#include "event_bus.h"
+
+#define PROTECT_TASK_PRIORITY   (configMAX_PRIORITIES - 2)  // preempts every control task
+#define PROTECT_TASK_STACK      (2048)
+
+static const char *fault_names[] = {
+    [WIPER_FAULT_NONE]        = "NONE",
+    [WIPER_FAULT_OVERCURRENT] = "OVERCUR",
+    [WIPER_FAULT_OVERLOAD]    = "OVERLOAD",
+    [WIPER_FAULT_STALL]       = "STALL",
+};
+
+static volatile wiper_fault_t fault;    // latched fault
+static TaskHandle_t protect_task_handle;
+#if CONFIG_WIPER_STATIC_ALLOC
+static StackType_t protect_stack[PROTECT_TASK_STACK];
+static StaticTask_t protect_tcb;
+#endif
+static void (*cutoff_cb)(void);         // cuts the servo PWM
+
+#if CONFIG_WIPER_CURRENT_PROTECTION
+
+#define RATED_MA2       ((int64_t)CONFIG_WIPER_CURRENT_RATED_MA * CONFIG_WIPER_CURRENT_RATED_MA)
+#define I2T_LIMIT       ((int64_t)CONFIG_WIPER_CURRENT_I2T_LIMIT * 1000000000LL)   // A^2*ms in mA^2*us
+
+static int64_t i2t;                     // mA^2*us accumulated above the rated current
+static volatile int peak_ma;            // highest current seen since the last reset
+static volatile bool model_clear;       // ask the ISR to restart the model after a reset
+
+// DMA interrupt: run every current sample through the trip level and the I2t model
+static void IRAM_ATTR protect_current_samples(const int *raw, int count, int sample_us)
+{
+    wiper_fault_t tripped = WIPER_FAULT_NONE;
+
+    if (model_clear){
+        i2t = 0;
+        peak_ma = 0;
+        model_clear = false;
+    }
+
+    for (int i = 0; i < count; i++){
+        int ma = analog_in_raw_to_mv(ANALOG_MOTOR_CURRENT, raw[i]) * 1000 / CONFIG_WIPER_CURRENT_MV_PER_A;
+        if (ma > peak_ma){
+            peak_ma = ma;
+        }
+        if (ma > CONFIG_WIPER_CURRENT_TRIP_MA){
+            tripped = WIPER_FAULT_OVERCURRENT;
+        }
+
+        // charge above the rated current, discharge below it
+        i2t += ((int64_t)ma * ma - RATED_MA2) * sample_us;
+        if (i2t < 0){
+            i2t = 0;
+        }
+        else if (i2t > I2T_LIMIT && tripped == WIPER_FAULT_NONE){
+            tripped = WIPER_FAULT_OVERLOAD;
+        }
+    }
+
+    if (tripped != WIPER_FAULT_NONE && fault == WIPER_FAULT_NONE){
+        BaseType_t woken = pdFALSE;
+        fault = tripped;
+        vTaskNotifyGiveFromISR(protect_task_handle, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+#endif
+
+// Task to cut the motor as soon as a fault is latched
+static void protect_task(void *pvParameter)
+{
+    while (1){
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        cutoff_cb();
+        event_log_add(EVENT_WIPER_FAULT, fault);
+        bus_event_t event = { .topic = BUS_FAULT, .fault = fault };
+        bus_publish(&event);
+#if CONFIG_WIPER_CURRENT_PROTECTION
+        printf("Wiper fault: %s (peak %d mA).\n", fault_names[fault], peak_ma);
+#else
+        printf("Wiper fault: %s.\n", fault_names[fault]);
+#endif
+    }
+}
+
+void wiper_protect_init(void (*cutoff)(void))
+{
+    cutoff_cb = cutoff;
+#if CONFIG_WIPER_STATIC_ALLOC
+    protect_task_handle = xTaskCreateStatic(protect_task, "Protect_Task", PROTECT_TASK_STACK, NULL, PROTECT_TASK_PRIORITY,
+                                            protect_stack, &protect_tcb);
+#else
+    xTaskCreate(protect_task, "Protect_Task", PROTECT_TASK_STACK, NULL, PROTECT_TASK_PRIORITY, &protect_task_handle);
+#endif
+#if CONFIG_WIPER_CURRENT_PROTECTION
+    analog_in_set_fast_handler(ANALOG_MOTOR_CURRENT, protect_current_samples);
+#endif
+}
+
+void wiper_protect_trip(wiper_fault_t tripped)
+{
+    if (fault == WIPER_FAULT_NONE){
+        fault = tripped;
+        xTaskNotifyGive(protect_task_handle);
+    }
+}
+
+wiper_fault_t wiper_protect_fault(void)
+{
+    return fault;
+}
+
+void wiper_protect_reset(void)
+{
+    if (fault != WIPER_FAULT_NONE){
+        event_log_add(EVENT_WIPER_FAULT_CLEARED, fault);
+#if CONFIG_WIPER_CURRENT_PROTECTION
+        model_clear = true;
+#endif
+        fault = WIPER_FAULT_NONE;
+    }
+}
+
+const char *wiper_protect_fault_name(wiper_fault_t f)
+{
+    return fault_names[f];
+}
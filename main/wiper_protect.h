@@ -0,0 +1,27 @@
+#ifndef WIPER_PROTECT_H
+#define WIPER_PROTECT_H
+
+// wiper motor faults, latched until wiper_protect_reset()
+typedef enum {
+    WIPER_FAULT_NONE = 0,
+    WIPER_FAULT_OVERCURRENT,    // current above CONFIG_WIPER_CURRENT_TRIP_MA
+    WIPER_FAULT_OVERLOAD,       // I2t model above CONFIG_WIPER_CURRENT_I2T_LIMIT
+    WIPER_FAULT_STALL,          // servo feedback saw the arm stop short of its command
+} wiper_fault_t;
+
+// start the protection task, cutoff is called from it as soon as a fault trips
+void wiper_protect_init(void (*cutoff)(void));
+
+// trip a fault from task context (e.g. a stall seen by the servo feedback)
+void wiper_protect_trip(wiper_fault_t fault);
+
+// current fault, WIPER_FAULT_NONE while the motor may be driven
+wiper_fault_t wiper_protect_fault(void);
+
+// clear a latched fault once the arm may be driven again
+void wiper_protect_reset(void);
+
+// short name of a fault for the LCD
+const char *wiper_protect_fault_name(wiper_fault_t fault);
+
+#endif
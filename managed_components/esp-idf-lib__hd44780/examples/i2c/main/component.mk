@@ -1 +0,0 @@
-COMPONENT_ADD_INCLUDEDIRS = . include/
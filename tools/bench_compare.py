@@ -0,0 +1,60 @@
+#!/usr/bin/env python
+"""Compare two hd44780 benchmark runs (bench/hd44780).
+
+Reads the "bench," CSV lines from captured `idf.py monitor` logs (other lines are
+ignored) and prints the median time of every transport/operation in both runs with
+the change in percent. Exits with status 1 if any median got slower by more than
+--threshold percent.
+
+    python tools/bench_compare.py before.log after.log [--threshold 5]
+"""
+import argparse
+import sys
+
+COLUMNS = ['transport', 'op', 'samples', 'min_us', 'median_us', 'max_us', 'chars_per_s']
+
+
+def load(path):
+    """{(transport, op): row} from the bench lines of a log."""
+    rows = {}
+    with open(path, errors='replace') as log:
+        for line in log:
+            fields = line.strip().split(',')
+            if fields[0] != 'bench' or len(fields) != len(COLUMNS) + 1 or fields[1] == 'transport':
+                continue
+            row = dict(zip(COLUMNS, fields[1:]))
+            for key in COLUMNS[2:]:
+                row[key] = int(row[key])
+            rows[(row['transport'], row['op'])] = row
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('before')
+    parser.add_argument('after')
+    parser.add_argument('--threshold', type=float, default=5.0, help='allowed slowdown in percent')
+    args = parser.parse_args()
+
+    before = load(args.before)
+    after = load(args.after)
+    if not before or not after:
+        sys.exit('no bench lines in %s' % (args.before if not before else args.after))
+
+    slower = 0
+    print('%-9s %-17s %10s %10s %8s' % ('transport', 'op', 'before_us', 'after_us', 'change'))
+    for key in sorted(set(before) | set(after)):
+        if key not in before or key not in after:
+            print('%-9s %-17s only in one run' % key)
+            continue
+        old = before[key]['median_us']
+        new = after[key]['median_us']
+        change = (new - old) * 100.0 / old if old else 0.0
+        if change > args.threshold:
+            slower += 1
+        print('%-9s %-17s %10d %10d %+7.1f%%' % (key[0], key[1], old, new, change))
+    sys.exit(1 if slower else 0)
+
+
+if __name__ == '__main__':
+    main()
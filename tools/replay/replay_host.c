@@ -0,0 +1,52 @@
+// Runs a replay suite on the PC: replay_host <suite> checks it, replay_host --record <suite>
+// prints it with the expected outputs regenerated from the current code.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    char *text;
+    long len;
+
+    if (f == NULL){
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    text = malloc(len + 1);
+    if (text != NULL){
+        text[fread(text, 1, len, f)] = '\0';
+    }
+    fclose(f);
+    return text;
+}
+
+int main(int argc, char **argv)
+{
+    int record = argc == 3 && strcmp(argv[1], "--record") == 0;
+    char *suite;
+    int failed = 0;
+
+    if (argc != 2 && !record){
+        fprintf(stderr, "usage: %s [--record] <suite>\n", argv[0]);
+        return 2;
+    }
+    suite = read_file(argv[argc - 1]);
+    if (suite == NULL){
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[argc - 1]);
+        return 2;
+    }
+
+    if (record){
+        replay_record(suite, stdout);
+    }
+    else{
+        failed = replay_check(suite, NULL);
+    }
+    free(suite);
+    return failed ? 1 : 0;
+}
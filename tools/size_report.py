@@ -0,0 +1,157 @@
+#!/usr/bin/env python
+"""RAM and flash use per component from the firmware's link map.
+
+Reads the GNU ld map file of an ESP-IDF build (build/<project>.map) and adds up the
+input sections of every archive by the memory they end up in:
+
+    data     initialised DRAM (.dram0.data), also stored in flash
+    bss      zeroed and no-init DRAM (.dram0.bss, .noinit), static task stacks land here
+    iram     code and data in internal instruction RAM (.iram0.*), also stored in flash
+    rtc      RTC memory (.rtc*)
+    code     flash code (.flash.text)
+    rodata   flash constants (.flash.rodata, .flash.appdesc)
+
+Archives are named after their component (libmain.a is main). The esp_driver_*,
+driver and esp_adc archives are grouped as "drivers". Static RAM is data + bss + iram.
+With --budget-kb the script exits with status 1 if the static RAM of the whole image is
+over the budget, which is how the build enforces CONFIG_WIPER_RAM_BUDGET_KB.
+
+    python tools/size_report.py build/LCD_display_starter_code.map [--budget-kb 192]
+"""
+import argparse
+import re
+import sys
+
+KINDS = ['data', 'bss', 'iram', 'rtc', 'code', 'rodata']
+
+# output section name prefix -> kind, first match wins
+SECTION_KINDS = [
+    ('.dram0.data', 'data'),
+    ('.dram0.bss', 'bss'),
+    ('.noinit', 'bss'),
+    ('.iram0', 'iram'),
+    ('.rtc', 'rtc'),
+    ('.flash.text', 'code'),
+    ('.flash.rodata_noload', None),     # reserved address space, not stored
+    ('.flash.rodata', 'rodata'),
+    ('.flash.appdesc', 'rodata'),
+]
+
+INPUT_LINE = re.compile(r'^ (\S+)\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)\s*(.*)$')    # section, address, size, file
+INPUT_NAME = re.compile(r'^ (\S+)$')                                                # a long section name wraps
+INPUT_WRAPPED = re.compile(r'^\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)\s*(.*)$')
+ARCHIVE = re.compile(r'lib([^/\\]+)\.a\(')
+
+
+def section_kind(name):
+    for prefix, kind in SECTION_KINDS:
+        if name.startswith(prefix):
+            return kind
+    return None
+
+
+def component(path, section):
+    """Component an input section belongs to."""
+    if section == '*fill*':
+        return '(padding)'
+    match = ARCHIVE.search(path)
+    if not match:
+        return '(other)' if path else '(linker)'
+    name = match.group(1)
+    if name == 'driver' or name.startswith('esp_driver_') or name == 'esp_adc':
+        return 'drivers'
+    return name
+
+
+def load(path):
+    """{component: {kind: bytes}} from a map file."""
+    sizes = {}
+    kind = None
+    wrapped = None
+    in_map = False
+    with open(path, errors='replace') as map_file:
+        for line in map_file:
+            line = line.rstrip('\n')
+            if not in_map:
+                in_map = line.startswith('Linker script and memory map')
+                continue
+            if line.startswith('.'):
+                kind = section_kind(line.split()[0])    # next output section
+                wrapped = None
+                continue
+            if kind is None:
+                continue
+            if wrapped is not None:
+                match = INPUT_WRAPPED.match(line)
+                section, wrapped = wrapped, None
+                if not match:
+                    continue
+                size, source = int(match.group(1), 16), match.group(2)
+            else:
+                match = INPUT_LINE.match(line)
+                if not match:
+                    name = INPUT_NAME.match(line)
+                    if name and not name.group(1).startswith('*('):
+                        wrapped = name.group(1)
+                    continue
+                section, size, source = match.group(1), int(match.group(2), 16), match.group(3)
+            if size == 0 or section.startswith('*('):
+                continue
+            totals = sizes.setdefault(component(source.strip(), section), dict.fromkeys(KINDS, 0))
+            totals[kind] += size
+    return sizes
+
+
+def static_ram(totals):
+    return totals['data'] + totals['bss'] + totals['iram']
+
+
+def flash(totals):
+    return totals['data'] + totals['iram'] + totals['code'] + totals['rodata']
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('map')
+    parser.add_argument('--budget-kb', type=int, default=0, help='static RAM budget, 0 = report only')
+    parser.add_argument('--top', type=int, default=12, help='components listed before the rest are summed')
+    args = parser.parse_args()
+
+    sizes = load(args.map)
+    if not sizes:
+        sys.exit('no sections found in %s' % args.map)
+
+    order = sorted(sizes, key=lambda name: (static_ram(sizes[name]), flash(sizes[name])), reverse=True)
+    # the project's own components are always listed
+    listed = [name for name in order if name in ('main', 'hd44780', 'esp_idf_lib_helpers', 'drivers')]
+    listed += [name for name in order if name not in listed][:max(args.top - len(listed), 0)]
+    rest = dict.fromkeys(KINDS, 0)
+    for name in order:
+        if name not in listed:
+            for kind in KINDS:
+                rest[kind] += sizes[name][kind]
+    total = dict.fromkeys(KINDS, 0)
+    for name in order:
+        for kind in KINDS:
+            total[kind] += sizes[name][kind]
+
+    print('%-22s %8s %8s %8s %6s %8s %8s %9s %9s' % (('component',) + tuple(KINDS) + ('ram', 'flash')))
+    rows = [(name, sizes[name]) for name in listed]
+    rows += [('(%d others)' % (len(order) - len(listed)), rest)] if len(order) > len(listed) else []
+    for name, totals in rows + [('total', total)]:
+        print('%-22s %8d %8d %8d %6d %8d %8d %9d %9d' % ((name,) + tuple(totals[kind] for kind in KINDS) +
+                                                       (static_ram(totals), flash(totals))))
+
+    used = static_ram(total)
+    if args.budget_kb:
+        budget = args.budget_kb * 1024
+        print('Static RAM: %d of %d bytes budget, %d bytes headroom' % (used, budget, budget - used))
+        if used > budget:
+            print('Static RAM is over the budget by %d bytes' % (used - budget), file=sys.stderr)
+            sys.exit(1)
+    else:
+        print('Static RAM: %d bytes' % used)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,136 @@
+#!/usr/bin/env python
+"""Stand-in for the wiper controller's telemetry endpoint (main/telemetry.c).
+
+Serves GET /status on localhost with the same JSON document the board sends.
+The simulated unit starts its engine, cycles the wiper knob through
+OFF/INT/LOW/HIGH and turns the engine off again, so fleet dashboards and
+scripts can be developed and tested without a board or a network.
+
+    python tools/telemetry_mock.py serve [--port 8080]
+    python tools/telemetry_mock.py check http://<board-ip>/status
+
+`check` fetches a status document (from the board or this mock) and checks
+that it has every field with the right type.
+"""
+import argparse
+import json
+import sys
+import time
+import urllib.request
+from http.server import BaseHTTPRequestHandler, HTTPServer
+
+ENGINE_NAMES = ['IDLE', 'SEATED', 'RUNNING', 'OFF', 'INHIBITED']
+WIPER_NAMES = ['OFF', 'INT', 'LOW', 'HIGH']
+INT_DELAYS_MS = [1000, 3000, 5000]
+FAULT_NAMES = ['NONE', 'OVERCUR', 'OVERLOAD', 'STALL']
+TASKS = [('Control_Task', 10), ('Display_Task', 50), ('Wiper_Task', 600)]
+
+FIELDS = {
+    'uptime_s': int,
+    'engine': str,
+    'wiper': str,
+    'int_delay_ms': int,
+    'fault': str,
+    'tasks': list,
+}
+TASK_FIELDS = {
+    'name': str,
+    'period_ms': int,
+    'max_period_ms': int,
+    'stack_free': int,
+    'missed': int,
+    'restarts': int,
+}
+
+
+def snapshot(uptime_s):
+    """Status document for a simulated unit uptime_s seconds after boot."""
+    # a 60 s drive: seated, engine running through each wiper mode, engine off
+    phase = uptime_s % 60
+    if phase < 5:
+        engine, wiper = 'SEATED', 0
+    elif phase < 55:
+        engine, wiper = 'RUNNING', (phase - 5) // 10 % 4
+    else:
+        engine, wiper = 'OFF', 0
+    running = engine == 'RUNNING'
+    return {
+        'uptime_s': uptime_s,
+        'engine': engine,
+        'wiper': WIPER_NAMES[wiper],
+        'int_delay_ms': INT_DELAYS_MS[uptime_s // 60 % 3] if wiper == 1 else 0,
+        'fault': FAULT_NAMES[0],
+        'tasks': [
+            {
+                'name': name,
+                'period_ms': period_ms if running or name != 'Wiper_Task' else 0,
+                'max_period_ms': period_ms + period_ms // 5,
+                'stack_free': 1024,
+                'missed': 0,
+                'restarts': 0,
+            }
+            for name, period_ms in TASKS
+        ],
+    }
+
+
+def validate(doc):
+    """List of problems with a status document, empty when it is well formed."""
+    problems = []
+    for field, kind in FIELDS.items():
+        if not isinstance(doc.get(field), kind):
+            problems.append('%s missing or not %s' % (field, kind.__name__))
+    if doc.get('engine') not in ENGINE_NAMES + ['?']:
+        problems.append('unknown engine state %r' % doc.get('engine'))
+    if doc.get('wiper') not in WIPER_NAMES:
+        problems.append('unknown wiper mode %r' % doc.get('wiper'))
+    if doc.get('fault') not in FAULT_NAMES:
+        problems.append('unknown fault %r' % doc.get('fault'))
+    for task in doc.get('tasks') or []:
+        for field, kind in TASK_FIELDS.items():
+            if not isinstance(task.get(field), kind):
+                problems.append('task %s: %s missing or not %s' % (task.get('name'), field, kind.__name__))
+    return problems
+
+
+class StatusHandler(BaseHTTPRequestHandler):
+    start = time.time()
+
+    def do_GET(self):
+        if self.path != '/status':
+            self.send_error(404)
+            return
+        body = json.dumps(snapshot(int(time.time() - self.start)), separators=(',', ':')).encode()
+        self.send_response(200)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest='command', required=True)
+    serve = commands.add_parser('serve', help='serve a simulated unit on localhost')
+    serve.add_argument('--port', type=int, default=8080)
+    check = commands.add_parser('check', help='fetch a status document and check its fields')
+    check.add_argument('url')
+    args = parser.parse_args()
+
+    if args.command == 'serve':
+        server = HTTPServer(('127.0.0.1', args.port), StatusHandler)
+        print('Mock telemetry on http://127.0.0.1:%d/status' % args.port)
+        server.serve_forever()
+    else:
+        with urllib.request.urlopen(args.url, timeout=5) as response:
+            doc = json.load(response)
+        problems = validate(doc)
+        for problem in problems:
+            print(problem)
+        if problems:
+            sys.exit(1)
+        print('%s: engine %s, wipers %s, %d tasks' % (args.url, doc['engine'], doc['wiper'], len(doc['tasks'])))
+
+
+if __name__ == '__main__':
+    main()